@@ -0,0 +1,367 @@
+#include "Hash.hpp"
+#include "HashMap.hpp"
+#include "SmallHashMap.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(DNSGE_BENCH_ABSL)
+#    include <absl/container/flat_hash_map.h>
+#endif
+
+using namespace dnsge;
+
+namespace {
+
+/**
+ * @brief Murmur3 finalizer. std::hash<uint64_t> is the identity on common
+ * standard libraries, which leaves the level 2 hash with no entropy.
+ */
+struct MixHasher {
+    // Already mixed, so the maps use the hashes as they are
+    using is_avalanching = void;
+
+    size_t operator()(uint64_t x) const {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    size_t operator()(const std::string &s) const {
+        return std::hash<std::string>()(s);
+    }
+};
+
+template <typename K>
+using DnsgeMap = HashMap<K, uint64_t, MixHasher>;
+
+template <typename K>
+using DnsgePowerOfTwoMap =
+    HashMap<K, uint64_t, MixHasher, std::equal_to<K>, PowerOfTwoHashMapPolicy>;
+
+template <typename K>
+using DnsgeNodeMap = NodeHashMap<K, uint64_t, MixHasher>;
+
+template <typename K>
+using DnsgeSeededMap = HashMap<K, uint64_t, SeededHash<K>>;
+
+template <typename K>
+using DnsgeSmallMap = SmallHashMap<K, uint64_t, 8, MixHasher>;
+
+template <typename K>
+using StdMap = std::unordered_map<K, uint64_t, MixHasher>;
+
+#if defined(DNSGE_BENCH_ABSL)
+template <typename K>
+using AbslMap = absl::flat_hash_map<K, uint64_t>;
+#endif
+
+// Element counts are a fraction of a power of two, which stays just below
+// MaxLoadFactor for tables that grow by doubling
+constexpr double FillFactor = 0.86;
+static_assert(FillFactor < DnsgeMap<uint64_t>::MaxLoadFactor);
+
+size_t elementCount(const benchmark::State &state) {
+    return static_cast<size_t>(static_cast<double>(state.range(0)) * FillFactor);
+}
+
+template <typename K>
+K makeKey(uint64_t n);
+
+template <>
+uint64_t makeKey<uint64_t>(uint64_t n) {
+    return n;
+}
+
+template <>
+std::string makeKey<std::string>(uint64_t n) {
+    // Long enough to defeat the small string optimization
+    return "benchmark-key-" + std::to_string(n) + "-padding";
+}
+
+/**
+ * @brief Generate distinct random keys. Keys from different seeds overlap with
+ * negligible probability, so a second call gives keys that miss.
+ */
+template <typename K>
+std::vector<K> makeKeys(size_t n, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<K> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys.push_back(makeKey<K>(rng()));
+    }
+    return keys;
+}
+
+template <typename Map>
+Map makeMap(const std::vector<typename Map::key_type> &keys) {
+    Map map;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        map.insert({keys[i], i});
+    }
+    return map;
+}
+
+template <typename Map, typename = void>
+struct IsIterable : std::false_type {};
+
+template <typename Map>
+struct IsIterable<Map, std::void_t<decltype(std::declval<Map &>().begin())>> : std::true_type {};
+
+template <typename Map>
+void BM_Insert(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    for (auto _ : state) {
+        Map map;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map.insert({keys[i], i});
+        }
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+template <typename Map>
+void BM_ReserveThenFill(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    for (auto _ : state) {
+        Map map;
+        map.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map.insert({keys[i], i});
+        }
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+/**
+ * @brief Build a table from a range of pairs in one call.
+ */
+template <typename Map>
+void BM_BulkInsert(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    std::vector<std::pair<typename Map::key_type, uint64_t>> pairs;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        pairs.emplace_back(keys[i], i);
+    }
+    for (auto _ : state) {
+        Map map(pairs.begin(), pairs.end());
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+template <typename Map>
+void BM_LookupHit(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    Map map = makeMap<Map>(keys);
+    // Look keys up in a different order than they were inserted
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(2));
+    for (auto _ : state) {
+        for (const auto &key : keys) {
+            benchmark::DoNotOptimize(map.find(key));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+/**
+ * @brief Hit lookups through find_batch, in batches the size of a typical request.
+ */
+template <typename Map>
+void BM_LookupHitBatch(benchmark::State &state) {
+    constexpr size_t RequestSize = 128;
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    Map map = makeMap<Map>(keys);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(2));
+    std::vector<typename Map::iterator> results(RequestSize);
+    for (auto _ : state) {
+        for (size_t i = 0; i + RequestSize <= keys.size(); i += RequestSize) {
+            map.find_batch(keys.begin() + i, keys.begin() + i + RequestSize, results.begin());
+            benchmark::DoNotOptimize(results.data());
+        }
+    }
+    state.SetItemsProcessed(
+        static_cast<int64_t>(state.iterations() * (keys.size() / RequestSize * RequestSize)));
+}
+
+template <typename Map>
+void BM_LookupMiss(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    Map map = makeMap<Map>(keys);
+    auto misses = makeKeys<typename Map::key_type>(keys.size(), 3);
+    for (auto _ : state) {
+        for (const auto &key : misses) {
+            benchmark::DoNotOptimize(map.find(key));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * misses.size()));
+}
+
+/**
+ * @brief Erase an element and insert a new one at a steady size, which
+ * accumulates deleted slots.
+ */
+template <typename Map>
+void BM_EraseChurn(benchmark::State &state) {
+    size_t n = elementCount(state);
+    auto keys = makeKeys<typename Map::key_type>(2 * n, 1);
+    Map map;
+    for (size_t i = 0; i < n; ++i) {
+        map.insert({keys[i], i});
+    }
+    size_t oldest = 0;
+    size_t next = n;
+    for (auto _ : state) {
+        map.erase(keys[oldest]);
+        map.insert({keys[next], next});
+        oldest = oldest + 1 == keys.size() ? 0 : oldest + 1;
+        next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/**
+ * @brief Grow a full table to twice its capacity, rehashing on state.range(1)
+ * threads. 0 rehashes serially through reserve without an executor.
+ */
+template <typename Map>
+void BM_Rehash(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    auto threads = static_cast<size_t>(state.range(1));
+    for (auto _ : state) {
+        state.PauseTiming();
+        Map map = makeMap<Map>(keys);
+        state.ResumeTiming();
+        if (threads == 0) {
+            map.reserve(2 * keys.size());
+        } else {
+            map.reserve(2 * keys.size(), ThreadExecutor(threads));
+        }
+        benchmark::DoNotOptimize(map);
+        state.PauseTiming();
+        // Keep destroying the map out of the measurement
+        { Map discard = std::move(map); }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+template <typename Map>
+void BM_Copy(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+    Map map = makeMap<Map>(keys);
+    for (auto _ : state) {
+        Map copy = map;
+        benchmark::DoNotOptimize(copy);
+        state.PauseTiming();
+        { Map discard = std::move(copy); }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+template <typename Map>
+void BM_Iterate(benchmark::State &state) {
+    if constexpr (IsIterable<Map>::value) {
+        auto keys = makeKeys<typename Map::key_type>(elementCount(state), 1);
+        Map map = makeMap<Map>(keys);
+        for (auto _ : state) {
+            uint64_t sum = 0;
+            for (const auto &entry : map) {
+                sum += entry.second;
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+    } else {
+        state.SkipWithError("Map is not iterable");
+    }
+}
+
+/**
+ * @brief Build a short-lived map of a few elements and look each one up, as
+ * per-request maps do.
+ */
+template <typename Map>
+void BM_TinyMap(benchmark::State &state) {
+    auto keys = makeKeys<typename Map::key_type>(static_cast<size_t>(state.range(0)), 1);
+    for (auto _ : state) {
+        Map map;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map.insert({keys[i], i});
+        }
+        uint64_t sum = 0;
+        for (const auto &key : keys) {
+            sum += map.find(key)->second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+// Table sizes from fitting in L1 to well beyond the last level cache
+void TableSizes(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(8)->Range(1 << 8, 1 << 20);
+}
+
+// Maps small enough to stay inline in a SmallHashMap, and one past it
+void TinySizes(benchmark::internal::Benchmark* b) {
+    b->Arg(2)->Arg(4)->Arg(8)->Arg(9);
+}
+
+// Large tables, rehashed serially and on a growing number of threads
+void RehashSizes(benchmark::internal::Benchmark* b) {
+    b->ArgsProduct({{1 << 20, 1 << 22}, {0, 1, 2, 4, 8}})->Unit(benchmark::kMillisecond);
+}
+
+#define DNSGE_BENCH_WORKLOADS(Map)                                                               \
+    BENCHMARK_TEMPLATE(BM_Insert, Map)->Apply(TableSizes);                                      \
+    BENCHMARK_TEMPLATE(BM_ReserveThenFill, Map)->Apply(TableSizes);                             \
+    BENCHMARK_TEMPLATE(BM_BulkInsert, Map)->Apply(TableSizes);                                  \
+    BENCHMARK_TEMPLATE(BM_LookupHit, Map)->Apply(TableSizes);                                   \
+    BENCHMARK_TEMPLATE(BM_LookupMiss, Map)->Apply(TableSizes);                                  \
+    BENCHMARK_TEMPLATE(BM_EraseChurn, Map)->Apply(TableSizes);                                  \
+    BENCHMARK_TEMPLATE(BM_Iterate, Map)->Apply(TableSizes)
+
+#define DNSGE_BENCH_MAP(Map)                                                                     \
+    DNSGE_BENCH_WORKLOADS(Map<uint64_t>);                                                       \
+    DNSGE_BENCH_WORKLOADS(Map<std::string>)
+
+DNSGE_BENCH_MAP(DnsgeMap);
+DNSGE_BENCH_MAP(DnsgePowerOfTwoMap);
+DNSGE_BENCH_MAP(DnsgeNodeMap);
+DNSGE_BENCH_MAP(DnsgeSeededMap);
+BENCHMARK_TEMPLATE(BM_LookupHitBatch, DnsgeMap<uint64_t>)->Apply(TableSizes);
+BENCHMARK_TEMPLATE(BM_LookupHitBatch, DnsgeMap<std::string>)->Apply(TableSizes);
+BENCHMARK_TEMPLATE(BM_LookupHitBatch, DnsgePowerOfTwoMap<uint64_t>)->Apply(TableSizes);
+BENCHMARK_TEMPLATE(BM_Rehash, DnsgeMap<uint64_t>)->Apply(RehashSizes);
+BENCHMARK_TEMPLATE(BM_Rehash, DnsgeMap<std::string>)->Apply(RehashSizes);
+BENCHMARK_TEMPLATE(BM_Copy, DnsgeMap<uint64_t>)->Apply(TableSizes);
+BENCHMARK_TEMPLATE(BM_Copy, DnsgeMap<std::string>)->Apply(TableSizes);
+BENCHMARK_TEMPLATE(BM_TinyMap, DnsgeMap<uint64_t>)->Apply(TinySizes);
+BENCHMARK_TEMPLATE(BM_TinyMap, DnsgeSmallMap<uint64_t>)->Apply(TinySizes);
+BENCHMARK_TEMPLATE(BM_TinyMap, DnsgeMap<std::string>)->Apply(TinySizes);
+BENCHMARK_TEMPLATE(BM_TinyMap, DnsgeSmallMap<std::string>)->Apply(TinySizes);
+DNSGE_BENCH_MAP(StdMap);
+#if defined(DNSGE_BENCH_ABSL)
+DNSGE_BENCH_MAP(AbslMap);
+#endif
+
+} // namespace
+
+BENCHMARK_MAIN();
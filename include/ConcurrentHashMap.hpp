@@ -0,0 +1,387 @@
+#pragma once
+
+#include "HashMap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace dnsge {
+
+/**
+ * @brief A thread-safe HashMap split into independently locked shards. A key's
+ * shard is picked from the high bits of its hash, and each shard is a HashMap
+ * behind its own reader-writer lock, padded to a cache line so that shards do
+ * not contend through false sharing.
+ *
+ * Elements are never handed out by reference. Lookups copy values out or run a
+ * visitor while the shard is locked, which must not call back into the map.
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy,
+    typename Allocator = std::allocator<std::pair<const K, V>>>
+class ConcurrentHashMap {
+public:
+    using Map = HashMap<K, V, Hash, Eq, Policy, Allocator>;
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = typename Map::value_type;
+
+    static constexpr size_t DefaultShardCount = 64;
+
+    /**
+     * @brief Construct a new ConcurrentHashMap.
+     *
+     * @param shardCount Number of shards, rounded up to a power of two.
+     * @param alloc Allocator for the storage of every shard.
+     */
+    explicit ConcurrentHashMap(size_t shardCount = DefaultShardCount,
+                               const Allocator &alloc = Allocator())
+        : ConcurrentHashMap(shardCount, Hash(), Eq(), alloc) {}
+
+    /**
+     * @brief Construct a new ConcurrentHashMap with the function objects to hash
+     * and compare keys with, such as a SeededHash.
+     *
+     * @param shardCount Number of shards, rounded up to a power of two.
+     * @param hash Hash function, copied into every shard.
+     * @param eq Key equality function, copied into every shard.
+     * @param alloc Allocator for the storage of every shard.
+     */
+    ConcurrentHashMap(size_t shardCount,
+                      const Hash &hash,
+                      const Eq &eq = Eq(),
+                      const Allocator &alloc = Allocator())
+        : hash_(hash)
+        , shardBits_(shardBitsFor(shardCount)) {
+        this->shards_.reserve(this->shardCount());
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            this->shards_.push_back(std::make_unique<Shard>(hash, eq, alloc));
+        }
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap &other) = delete;
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &other) = delete;
+
+    /**
+     * @brief Copy the value of a key out of the map.
+     *
+     * @param key Key to look up.
+     * @return The value, or std::nullopt if the key is not present.
+     */
+    std::optional<V> get(const K &key) const {
+        std::optional<V> value;
+        this->visit(key, [&](const value_type &slot) { value = slot.second; });
+        return value;
+    }
+
+    /**
+     * @brief Check whether a key is present.
+     */
+    bool contains(const K &key) const {
+        size_t hash = this->hash_(key);
+        const Shard &shard = this->shardFor(hash);
+        std::shared_lock lock(shard.mutex);
+        return shard.map.contains(key, hash);
+    }
+
+    /**
+     * @brief Call f with the element of a key, holding the shard's lock shared.
+     *
+     * @param key Key to look up.
+     * @param f Called as f(const value_type &) if the key is present.
+     * @return Whether the key was present.
+     */
+    template <typename F>
+    bool visit(const K &key, F &&f) const {
+        size_t hash = this->hash_(key);
+        const Shard &shard = this->shardFor(hash);
+        std::shared_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hash);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        std::forward<F>(f)(*it);
+        return true;
+    }
+
+    /**
+     * @brief Call f with the element of a key, holding the shard's lock exclusively
+     * so that f may modify the value.
+     *
+     * @param key Key to look up.
+     * @param f Called as f(value_type &) if the key is present.
+     * @return Whether the key was present.
+     */
+    template <typename F>
+    bool visit(const K &key, F &&f) {
+        size_t hash = this->hash_(key);
+        Shard &shard = this->shardFor(hash);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hash);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        std::forward<F>(f)(*it);
+        return true;
+    }
+
+    /**
+     * @brief Insert a key-value pair if the key is not present.
+     *
+     * @return Whether the pair was inserted.
+     */
+    bool insert(std::pair<K, V> value) {
+        return this->insert_or_visit(std::move(value), [](value_type &) {});
+    }
+
+    /**
+     * @brief Insert a key-value pair if the key is not present, or otherwise call
+     * f with the existing element, as one atomic operation.
+     *
+     * @param value Key-value pair to insert.
+     * @param f Called as f(value_type &) if the key is present.
+     * @return Whether the pair was inserted.
+     */
+    template <typename F>
+    bool insert_or_visit(std::pair<K, V> value, F &&f) {
+        size_t hash = this->hash_(value.first);
+        Shard &shard = this->shardFor(hash);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(value.first, hash);
+        if (it != shard.map.end()) {
+            std::forward<F>(f)(*it);
+            return false;
+        }
+        shard.map.insert_hashed(std::move(value), hash);
+        return true;
+    }
+
+    /**
+     * @brief Assign a value to a key, inserting the key if it is not present.
+     *
+     * @return Whether the key was inserted.
+     */
+    template <typename M>
+    bool insert_or_assign(const K &key, M &&obj) {
+        size_t hash = this->hash_(key);
+        Shard &shard = this->shardFor(hash);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hash);
+        if (it != shard.map.end()) {
+            it->second = std::forward<M>(obj);
+            return false;
+        }
+        shard.map.insert_hashed({key, std::forward<M>(obj)}, hash);
+        return true;
+    }
+
+    /**
+     * @brief Replace the element of a key with a computed one, as one atomic
+     * operation.
+     *
+     * @param key Key to update.
+     * @param f Called as f(const V *) with the current value, or nullptr if the
+     * key is not present. Returns the new value as a std::optional<V>, or
+     * std::nullopt to erase the key.
+     * @return Whether the key is present afterwards.
+     */
+    template <typename F>
+    bool compute(const K &key, F &&f) {
+        size_t hash = this->hash_(key);
+        Shard &shard = this->shardFor(hash);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hash);
+        bool present = it != shard.map.end();
+        std::optional<V> value = std::forward<F>(f)(present ? &it->second : nullptr);
+        if (!value) {
+            if (present) {
+                shard.map.erase(it);
+            }
+            return false;
+        }
+        if (present) {
+            it->second = std::move(*value);
+        } else {
+            shard.map.insert_hashed({key, std::move(*value)}, hash);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Erase a key.
+     *
+     * @return Whether the key was present and erased.
+     */
+    bool erase(const K &key) {
+        return this->erase_if(key, [](const value_type &) { return true; });
+    }
+
+    /**
+     * @brief Erase a key if its element satisfies a predicate, as one atomic
+     * operation.
+     *
+     * @param key Key to erase.
+     * @param pred Called as pred(const value_type &) if the key is present.
+     * @return Whether the key was erased.
+     */
+    template <typename Pred>
+    bool erase_if(const K &key, Pred &&pred) {
+        size_t hash = this->hash_(key);
+        Shard &shard = this->shardFor(hash);
+        std::unique_lock lock(shard.mutex);
+        auto it = shard.map.find(key, hash);
+        if (it == shard.map.end() || !std::forward<Pred>(pred)(std::as_const(*it))) {
+            return false;
+        }
+        return shard.map.erase(it);
+    }
+
+    /**
+     * @brief Call f with every element, holding one shard's lock shared at a
+     * time. Not a snapshot: elements may change in shards not yet visited.
+     *
+     * @param f Called as f(const value_type &).
+     */
+    template <typename F>
+    void for_each(F &&f) const {
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            const Shard &shard = *this->shards_[i];
+            std::shared_lock lock(shard.mutex);
+            for (const auto &slot : shard.map) {
+                f(slot);
+            }
+        }
+    }
+
+    /**
+     * @brief Get the number of elements. Not a snapshot when other threads
+     * modify the map concurrently.
+     */
+    size_t size() const {
+        size_t size = 0;
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            const Shard &shard = *this->shards_[i];
+            std::shared_lock lock(shard.mutex);
+            size += shard.map.size();
+        }
+        return size;
+    }
+
+    bool empty() const {
+        return this->size() == 0;
+    }
+
+    /**
+     * @brief Erase every element that satisfies a predicate, sweeping one shard
+     * at a time. Each shard is swept in one pass under its exclusive lock, so
+     * elements inserted into a shard after it was swept are kept.
+     *
+     * @param pred Called as pred(const value_type &) for every element.
+     * @return Number of elements erased.
+     */
+    template <typename Pred>
+    size_t erase_if(Pred &&pred) {
+        size_t erased = 0;
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            Shard &shard = *this->shards_[i];
+            std::unique_lock lock(shard.mutex);
+            erased += shard.map.erase_if(pred);
+        }
+        return erased;
+    }
+
+    /**
+     * @brief Clear all elements, one shard at a time.
+     */
+    void clear() {
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            Shard &shard = *this->shards_[i];
+            std::unique_lock lock(shard.mutex);
+            shard.map.clear();
+        }
+    }
+
+    /**
+     * @brief Reserve room for at least n elements spread evenly over the shards.
+     */
+    void reserve(size_t n) {
+        size_t perShard = (n + this->shardCount() - 1) / this->shardCount();
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            Shard &shard = *this->shards_[i];
+            std::unique_lock lock(shard.mutex);
+            shard.map.reserve(perShard);
+        }
+    }
+
+    /**
+     * @brief Shrink every shard to fit its elements, one shard at a time.
+     */
+    void shrink_to_fit() {
+        for (size_t i = 0; i < this->shardCount(); ++i) {
+            Shard &shard = *this->shards_[i];
+            std::unique_lock lock(shard.mutex);
+            shard.map.shrink_to_fit();
+        }
+    }
+
+    size_t shardCount() const {
+        return size_t(1) << this->shardBits_;
+    }
+
+private:
+    struct alignas(detail::CacheLineSize) Shard {
+        Shard(const Hash &hash, const Eq &eq, const Allocator &alloc)
+            : map(Map::DefaultInitialCapacity, hash, eq, alloc) {}
+
+        mutable std::shared_mutex mutex;
+        Map map;
+    };
+
+    static size_t shardBitsFor(size_t shardCount) {
+        size_t bits = 0;
+        while ((size_t(1) << bits) < shardCount) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    /**
+     * @brief Pick the shard of a hash from the high bits of its Fibonacci product.
+     * The multiplication folds every bit of the hash into the high bits, so that
+     * hashes with little entropy there (such as the identity) still spread, while
+     * the low bits that index within a shard stay independent of the shard.
+     */
+    size_t shardIndex(size_t hash) const {
+        if (this->shardBits_ == 0) {
+            return 0;
+        }
+        constexpr uint64_t Fibonacci = 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>((static_cast<uint64_t>(hash) * Fibonacci) >>
+                                   (64 - this->shardBits_));
+    }
+
+    Shard &shardFor(size_t hash) {
+        return *this->shards_[this->shardIndex(hash)];
+    }
+
+    const Shard &shardFor(size_t hash) const {
+        return *this->shards_[this->shardIndex(hash)];
+    }
+
+    Hash hash_;
+    size_t shardBits_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace dnsge
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace dnsge {
+
+namespace detail {
+
+// Odd constants with well spread bits, from wyhash
+constexpr uint64_t HashSecret0 = 0xa0761d6478bd642fULL;
+constexpr uint64_t HashSecret1 = 0xe7037ed1a0b428dbULL;
+constexpr uint64_t HashSecret2 = 0x8ebc6af09c88c6e3ULL;
+constexpr uint64_t HashSecret3 = 0x589965cc75374cc3ULL;
+
+/**
+ * @brief Multiply two 64-bit values into a 128-bit product, returned as its low
+ * half in a and its high half in b.
+ */
+inline void MultiplyWide(uint64_t &a, uint64_t &b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ using Wide = unsigned __int128;
+    Wide product = static_cast<Wide>(a) * b;
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t aHigh = a >> 32, aLow = static_cast<uint32_t>(a);
+    uint64_t bHigh = b >> 32, bLow = static_cast<uint32_t>(b);
+    uint64_t high = aHigh * bHigh, middle0 = aHigh * bLow, middle1 = aLow * bHigh;
+    uint64_t low = aLow * bLow;
+    uint64_t carry = (low >> 32) + static_cast<uint32_t>(middle0) + static_cast<uint32_t>(middle1);
+    a = (carry << 32) | static_cast<uint32_t>(low);
+    b = high + (middle0 >> 32) + (middle1 >> 32) + (carry >> 32);
+#endif
+}
+
+/**
+ * @brief Fold the 128-bit product of two values into 64 bits. Every bit of the
+ * result depends on every bit of both inputs.
+ */
+inline uint64_t MultiplyFold(uint64_t a, uint64_t b) {
+    MultiplyWide(a, b);
+    return a ^ b;
+}
+
+inline uint64_t Read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t Read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Hash a byte string with a seed, in the style of wyhash. Values are
+ * stable for a seed on machines of the same byte order.
+ */
+inline uint64_t HashBytes(const void* data, size_t len, uint64_t seed) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    seed ^= MultiplyFold(seed ^ HashSecret0, HashSecret1);
+    uint64_t a;
+    uint64_t b;
+    if (len <= 16) {
+        if (len >= 4) {
+            // Two overlapping reads from each end cover every byte
+            size_t middle = (len >> 3) << 2;
+            a = (Read32(p) << 32) | Read32(p + middle);
+            b = (Read32(p + len - 4) << 32) | Read32(p + len - 4 - middle);
+        } else if (len > 0) {
+            a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        size_t remaining = len;
+        if (remaining > 48) {
+            // Three independent lanes keep the multipliers busy
+            uint64_t lane1 = seed;
+            uint64_t lane2 = seed;
+            do {
+                seed = MultiplyFold(Read64(p) ^ HashSecret1, Read64(p + 8) ^ seed);
+                lane1 = MultiplyFold(Read64(p + 16) ^ HashSecret2, Read64(p + 24) ^ lane1);
+                lane2 = MultiplyFold(Read64(p + 32) ^ HashSecret3, Read64(p + 40) ^ lane2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (remaining > 16) {
+            seed = MultiplyFold(Read64(p) ^ HashSecret1, Read64(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        // The last 16 bytes, overlapping bytes already hashed if needed
+        a = Read64(p + remaining - 16);
+        b = Read64(p + remaining - 8);
+    }
+    a ^= HashSecret1;
+    b ^= seed;
+    MultiplyWide(a, b);
+    return MultiplyFold(a ^ HashSecret0 ^ len, b ^ HashSecret1);
+}
+
+/**
+ * @brief Hash a 64-bit value with a seed.
+ */
+inline uint64_t HashWord(uint64_t value, uint64_t seed) {
+    return MultiplyFold(value ^ seed ^ HashSecret0, HashSecret1 ^ seed);
+}
+
+/**
+ * @brief Whether a hasher declares that its hashes are avalanching: that every
+ * bit of a hash depends on every bit of the key. The tables skip MixHash() for
+ * such hashers.
+ */
+template <typename Hash, typename = void>
+struct IsAvalanching : std::false_type {};
+
+template <typename Hash>
+struct IsAvalanching<Hash, std::void_t<typename Hash::is_avalanching>> : std::true_type {};
+
+/**
+ * @brief Spread the entropy of a hash over all of its bits. The tables take the
+ * low 7 bits of a hash for the control bytes and the rest for the probe start,
+ * so a weak hash such as the identity would otherwise leave keys that differ
+ * only in their high bits indistinguishable in the control bytes.
+ */
+inline size_t MixHash(size_t hash) {
+    // Differs from the multiplier ConcurrentHashMap picks shards with, so that
+    // the shard of a key and its position within the shard stay independent
+    constexpr uint64_t Multiplier = 0xbf58476d1ce4e5b9ULL;
+    return static_cast<size_t>(MultiplyFold(static_cast<uint64_t>(hash), Multiplier));
+}
+
+template <typename Hash>
+size_t MixHash(size_t hash) {
+    if constexpr (IsAvalanching<Hash>::value) {
+        return hash;
+    } else {
+        return MixHash(hash);
+    }
+}
+
+template <typename Hash, typename = void>
+struct HasSeed : std::false_type {};
+
+template <typename Hash>
+struct HasSeed<Hash, std::void_t<decltype(std::declval<const Hash &>().seed())>>
+    : std::true_type {};
+
+/**
+ * @brief Get the seed of a hasher, or 0 for hashers without a seed() member.
+ */
+template <typename Hash>
+uint64_t HashSeedOf(const Hash &hash) {
+    if constexpr (HasSeed<Hash>::value) {
+        return static_cast<uint64_t>(hash.seed());
+    } else {
+        static_cast<void>(hash);
+        return 0;
+    }
+}
+
+/**
+ * @brief Whether two hashers of a type hash every key alike when their
+ * HashSeedOf() is equal: stateless hashers always do, and seeded ones do with
+ * the same seed.
+ */
+template <typename Hash>
+constexpr bool SeedIdentifiesHash = HasSeed<Hash>::value || std::is_empty_v<Hash>;
+
+template <typename T>
+constexpr bool IsStringLike =
+    std::is_convertible_v<const T &, std::string_view> && !std::is_same_v<T, std::nullptr_t>;
+
+} // namespace detail
+
+/**
+ * @brief A fast, seeded hash function. Integers, enums and pointers are hashed
+ * with one wide multiplication, and strings with a wyhash-style byte hash.
+ * Other types are hashed with std::hash and then mixed with the seed.
+ *
+ * Hashes are avalanching, so the tables use them as they are. A table is only
+ * as resistant to hash flooding as its seed is secret: seed maps that hold
+ * untrusted keys with RandomSeed(). Hashers with equal seeds hash equally, and
+ * the default seed is fixed.
+ *
+ * For strings the hasher is transparent, so maps keyed by std::string can be
+ * looked up with std::string_view or const char* when paired with a transparent
+ * equality such as std::equal_to<>.
+ */
+template <typename T>
+class SeededHash {
+public:
+    using is_avalanching = void;
+
+    explicit SeededHash(uint64_t seed = 0)
+        : seed_(seed) {}
+
+    template <typename U = T>
+    std::enable_if_t<!detail::IsStringLike<U>, size_t> operator()(const T &value) const {
+        if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            return static_cast<size_t>(detail::HashWord(static_cast<uint64_t>(value), this->seed_));
+        } else if constexpr (std::is_pointer_v<T>) {
+            return static_cast<size_t>(
+                detail::HashWord(reinterpret_cast<uintptr_t>(value), this->seed_));
+        } else {
+            return static_cast<size_t>(
+                detail::HashWord(static_cast<uint64_t>(std::hash<T>()(value)), this->seed_));
+        }
+    }
+
+    template <typename U = T>
+    std::enable_if_t<detail::IsStringLike<U>, size_t> operator()(std::string_view value) const {
+        return static_cast<size_t>(detail::HashBytes(value.data(), value.size(), this->seed_));
+    }
+
+    uint64_t seed() const {
+        return this->seed_;
+    }
+
+    /**
+     * @brief Get a fresh unpredictable seed from std::random_device.
+     */
+    static uint64_t RandomSeed() {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) ^ device();
+    }
+
+private:
+    uint64_t seed_;
+};
+
+/**
+ * @brief SeededHash of strings, transparent to anything convertible to
+ * std::string_view.
+ */
+template <>
+class SeededHash<std::string> : public SeededHash<std::string_view> {
+public:
+    using is_transparent = void;
+    using SeededHash<std::string_view>::SeededHash;
+};
+
+} // namespace dnsge
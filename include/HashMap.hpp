@@ -1,19 +1,72 @@
 #pragma once
 
-#include "FixedUninitVec.hpp"
-
+#include "Hash.hpp"
+#include "Serialization.hpp"
+#include "TableStorage.hpp"
+#include "ThreadExecutor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <numeric>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+// Define DNSGE_HASHMAP_NO_SIMD to force the portable group implementation
+#if !defined(DNSGE_HASHMAP_NO_SIMD)
+#    if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#        define DNSGE_HASHMAP_HAVE_SSE2 1
+#    elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && \
+        __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#        define DNSGE_HASHMAP_HAVE_NEON 1
+#    endif
+#endif
+
+#if __has_include(<memory_resource>)
+#    include <memory_resource>
+#    define DNSGE_HASHMAP_HAVE_PMR 1
+#endif
+
+#if defined(DNSGE_HASHMAP_HAVE_SSE2)
+#    include <emmintrin.h>
+#elif defined(DNSGE_HASHMAP_HAVE_NEON)
+#    include <arm_neon.h>
+#endif
+
 namespace dnsge {
 
+/**
+ * @brief Whether moving a T and then destroying the source leaves the same
+ * bytes as copying them. Tables relocate such elements with memcpy when they
+ * rehash, skipping the allocator's construct() and destroy(). Specialize as
+ * std::true_type for types that qualify without being trivially copyable.
+ */
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename A, typename B>
+struct IsTriviallyRelocatable<std::pair<A, B>>
+    : std::bool_constant<IsTriviallyRelocatable<std::remove_const_t<A>>::value &&
+                         IsTriviallyRelocatable<B>::value> {};
+
+template <typename T>
+struct IsTriviallyRelocatable<std::unique_ptr<T>> : std::true_type {};
+
 namespace detail {
 
 // NOLINTBEGIN(readability-magic-numbers)
@@ -22,7 +75,8 @@ using metadata_t = uint8_t;
 
 enum Metadata : metadata_t {
     Empty = 0b10000000,
-    Deleted = 0b11111111,
+    Deleted = 0b11111110,
+    Sentinel = 0b11111111,
 };
 
 constexpr bool IsFree(metadata_t metadata) {
@@ -44,485 +98,3283 @@ static_assert(IsFree(Metadata::Empty), "Empty should be considered free");
 static_assert(IsFree(Metadata::Deleted), "Deleted should be considered free");
 static_assert(!IsFree(H2(0xFFFF)), "H2 of 0xFFFF should be not be considered free");
 
-// NOLINTEND(readability-magic-numbers)
+/**
+ * @brief Hint that the cache line holding an address is about to be read.
+ */
+inline void Prefetch(const void* addr) {
+    __builtin_prefetch(addr, 0, 3);
+}
+
+inline uint32_t TrailingZeros(uint64_t x) {
+    assert(x != 0);
+    return static_cast<uint32_t>(__builtin_ctzll(x));
+}
 
-}; // namespace detail
+inline uint32_t HighestBitSet(uint64_t x) {
+    assert(x != 0);
+    return 63 - static_cast<uint32_t>(__builtin_clzll(x));
+}
 
-template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
-class HashMap {
+/**
+ * @brief A set of slot positions within a Group. Each position occupies
+ * 2^Shift bits of the mask, of which only the highest may be set.
+ *
+ * Iterating a BitMask yields the set positions in increasing order.
+ */
+template <typename T, size_t Width, uint32_t Shift = 0>
+class BitMask {
 public:
-    static constexpr size_t DefaultInitialCapacity = 16;
-    static constexpr float MaxLoadFactor = 0.875;
-    static constexpr float MaxDeletedLoadFactor = 0.875;
-    static constexpr float GrowthFactor = 2;
+    explicit BitMask(T mask)
+        : mask_(mask) {}
 
-    using Slot = std::pair<const K, V>;
+    explicit operator bool() const {
+        return this->mask_ != 0;
+    }
 
-    static_assert(std::is_copy_assignable_v<K>, "Key must be copy assignable");
-    static_assert(std::is_move_constructible_v<Slot>, "Slot must be move constructable");
+    /**
+     * @brief Get the lowest set position. The mask must not be empty.
+     */
+    uint32_t lowestBitSet() const {
+        return TrailingZeros(this->mask_) >> Shift;
+    }
 
-    template <typename SlotType>
-    class MapIterator {
-    private:
-        MapIterator(size_t idex, SlotType* slotPtr)
-            : idex_(idex)
-            , slotPtr_(slotPtr) {}
+    /**
+     * @brief Get the number of unset positions above the highest set one. The
+     * mask must not be empty.
+     */
+    uint32_t leadingZeros() const {
+        constexpr uint32_t Bits = static_cast<uint32_t>(Width) << Shift;
+        return (Bits - 1 - HighestBitSet(this->mask_)) >> Shift;
+    }
 
-    public:
-        SlotType &operator*() const {
-            return *this->slotPtr_;
-        }
+    uint32_t operator*() const {
+        return this->lowestBitSet();
+    }
 
-        SlotType* operator->() const {
-            return this->slotPtr_;
-        }
+    BitMask &operator++() {
+        // Clear the lowest set bit
+        this->mask_ &= (this->mask_ - 1);
+        return *this;
+    }
 
-        bool operator==(const MapIterator &other) const {
-            return this->idex_ == other.idex_;
-        }
+    BitMask begin() const {
+        return *this;
+    }
 
-        bool operator!=(const MapIterator &other) const {
-            return this->idex_ != other.idex_;
-        }
+    BitMask end() const {
+        return BitMask(0);
+    }
 
-    private:
-        friend class HashMap<K, V, Hash, Eq>;
-        size_t idex_;
-        SlotType* slotPtr_;
-    };
+    bool operator==(const BitMask &other) const {
+        return this->mask_ == other.mask_;
+    }
 
-    using iterator = MapIterator<Slot>;
-    using const_iterator = MapIterator<const Slot>;
+    bool operator!=(const BitMask &other) const {
+        return this->mask_ != other.mask_;
+    }
+
+private:
+    T mask_;
+};
+
+/**
+ * @brief Portable group of 8 metadata bytes, matched with SWAR arithmetic on
+ * a single 64-bit word. Used when no SIMD instruction set is available.
+ */
+class GroupPortable {
+public:
+    static constexpr size_t Width = 8;
+    using Mask = BitMask<uint64_t, Width, 3>;
+
+    explicit GroupPortable(const metadata_t* pos) {
+        std::memcpy(&this->ctrl_, pos, sizeof(this->ctrl_));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        this->ctrl_ = __builtin_bswap64(this->ctrl_);
+#endif
+    }
 
     /**
-     * @brief Construct a new HashMap with a default capacity.
+     * @brief Get the positions that may match h2. False positives are possible,
+     * but only on full slots, so callers must still compare keys.
      */
-    HashMap()
-        : HashMap(DefaultInitialCapacity) {}
+    Mask match(metadata_t h2) const {
+        auto x = this->ctrl_ ^ (Lsbs * h2);
+        return Mask((x - Lsbs) & ~x & Msbs);
+    }
 
     /**
-     * @brief Construct a new HashMap with a specified capacity.
-     * 
-     * @param initialCapacity Initial slot capacity.
+     * @brief Get the positions that are Empty.
      */
-    HashMap(size_t initialCapacity)
-        : capacity_(initialCapacity)
-        , size_(0)
-        , slots_(initialCapacity)
-        , deletedCount_(0) {
-        this->metadata_.resize(initialCapacity, detail::Metadata::Empty);
+    Mask matchEmpty() const {
+        // Empty is the only special value with bit 1 clear
+        return Mask((this->ctrl_ & ~(this->ctrl_ << 6)) & Msbs);
     }
 
-    ~HashMap() {
-        if (this->empty()) {
-            return;
-        }
-        for (size_t i = 0; i < this->capacity_; ++i) {
-            if (!detail::IsFree(this->metadata_[i])) {
-                this->slots_[i].~Slot(); // Destroy slot entry
-            }
-        }
+    /**
+     * @brief Get the positions that are Empty or Deleted.
+     */
+    Mask matchEmptyOrDeleted() const {
+        // Sentinel is the only special value with bit 0 set
+        return Mask((this->ctrl_ & ~(this->ctrl_ << 7)) & Msbs);
     }
 
-    HashMap(const HashMap &other) = default;
-    HashMap &operator=(const HashMap &other) = default;
+    /**
+     * @brief Get the positions that are full.
+     */
+    Mask matchFull() const {
+        // Full is the only kind of value with the high bit clear
+        return Mask(~this->ctrl_ & Msbs);
+    }
 
-    HashMap(HashMap &&other) noexcept
-        : capacity_(other.capacity_)
-        , size_(other.size_)
-        , metadata_(std::move(other.metadata_))
-        , slots_(std::move(other.slots_))
-        , deletedCount_(other.deletedCount_) {
-        other.capacity_ = 0;
-        other.size_ = 0;
-        other.deletedCount_ = 0;
+private:
+    static constexpr uint64_t Lsbs = 0x0101010101010101ULL;
+    static constexpr uint64_t Msbs = 0x8080808080808080ULL;
+
+    uint64_t ctrl_;
+};
+
+#if defined(DNSGE_HASHMAP_HAVE_SSE2)
+
+/**
+ * @brief Group of 16 metadata bytes, matched with SSE2.
+ */
+class GroupSse2 {
+public:
+    static constexpr size_t Width = 16;
+    using Mask = BitMask<uint32_t, Width>;
+
+    explicit GroupSse2(const metadata_t* pos)
+        : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+    /**
+     * @brief Get the positions that match h2.
+     */
+    Mask match(metadata_t h2) const {
+        auto match = _mm_set1_epi8(static_cast<char>(h2));
+        return Mask(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(match, this->ctrl_))));
     }
 
-    HashMap &operator=(HashMap &&other) noexcept {
-        this->capacity_ = other.capacity_;
-        this->size_ = other.size_;
-        this->metadata_ = std::move(other.metadata_);
-        this->slots_ = std::move(other.slots_);
-        this->deletedCount_ = other.deletedCount_;
-        other.capacity_ = 0;
-        other.size_ = 0;
-        other.deletedCount_ = 0;
-        return *this;
+    /**
+     * @brief Get the positions that are Empty.
+     */
+    Mask matchEmpty() const {
+        return this->match(Metadata::Empty);
     }
 
     /**
-     * @brief Find a key-value pair in the HashMap.
-     * 
-     * @param key Key to look up.
-     * @return Iterator to the element, or end() if not found.
+     * @brief Get the positions that are Empty or Deleted.
      */
-    iterator find(const K &key) {
-        return this->iteratorAt(this->doFind(key));
+    Mask matchEmptyOrDeleted() const {
+        // As signed bytes, Empty and Deleted are the only values below Sentinel
+        auto sentinel = _mm_set1_epi8(static_cast<char>(Metadata::Sentinel));
+        return Mask(
+            static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(sentinel, this->ctrl_))));
     }
 
     /**
-     * @brief Find a key-value pair in the HashMap.
-     * 
-     * @param key Key to look up.
-     * @return Iterator to the element, or end() if not found.
+     * @brief Get the positions that are full.
      */
-    const_iterator find(const K &key) const {
-        return this->iteratorAt(this->doFind(key));
+    Mask matchFull() const {
+        // Full is the only kind of value with the high bit clear
+        return Mask(static_cast<uint32_t>(_mm_movemask_epi8(this->ctrl_)) ^ 0xFFFF);
     }
 
+private:
+    __m128i ctrl_;
+};
+
+using Group = GroupSse2;
+
+#elif defined(DNSGE_HASHMAP_HAVE_NEON)
+
+/**
+ * @brief Group of 8 metadata bytes, matched with NEON.
+ */
+class GroupNeon {
+public:
+    static constexpr size_t Width = 8;
+    using Mask = BitMask<uint64_t, Width, 3>;
+
+    explicit GroupNeon(const metadata_t* pos)
+        : ctrl_(vld1_u8(pos)) {}
+
     /**
-     * @brief Check whether a key is present in the HashMap.
-     * 
-     * @param key Key to look for.
+     * @brief Get the positions that match h2.
      */
-    bool contains(const K &key) const {
-        return this->doFind(key).has_value();
+    Mask match(metadata_t h2) const {
+        return toMask(vceq_u8(vdup_n_u8(h2), this->ctrl_));
     }
 
     /**
-     * @brief Get the value of a key in the HashMap. Throws std::out_of_range if
-     * the key is not in the HashMap.
-     *
-     * @param key Key to look up.
-     * @return Reference to found value.
+     * @brief Get the positions that are Empty.
      */
-    V &at(const K &key) {
-        auto res = this->doFind(key);
-        if (res) {
-            return this->slots_[res.value()].second;
+    Mask matchEmpty() const {
+        return this->match(Metadata::Empty);
+    }
+
+    /**
+     * @brief Get the positions that are Empty or Deleted.
+     */
+    Mask matchEmptyOrDeleted() const {
+        // As signed bytes, Empty and Deleted are the only values below Sentinel
+        auto sentinel = vdup_n_s8(static_cast<int8_t>(Metadata::Sentinel));
+        return toMask(vcgt_s8(sentinel, vreinterpret_s8_u8(this->ctrl_)));
+    }
+
+    /**
+     * @brief Get the positions that are full.
+     */
+    Mask matchFull() const {
+        // Full is the only kind of value with the high bit clear
+        return toMask(vcge_s8(vreinterpret_s8_u8(this->ctrl_), vdup_n_s8(0)));
+    }
+
+private:
+    static Mask toMask(uint8x8_t cmp) {
+        return Mask(vget_lane_u64(vreinterpret_u64_u8(cmp), 0) & 0x8080808080808080ULL);
+    }
+
+    uint8x8_t ctrl_;
+};
+
+using Group = GroupNeon;
+
+#else
+
+using Group = GroupPortable;
+
+#endif
+
+/**
+ * @brief Number of metadata bytes mirrored after the sentinel.
+ */
+constexpr size_t NumClonedBytes = Group::Width - 1;
+
+/**
+ * @brief Number of metadata bytes needed for a table of a capacity: one per slot,
+ * the sentinel, and the cloned bytes that let a group load start at any slot.
+ */
+constexpr size_t MetadataSize(size_t capacity) {
+    return capacity + 1 + NumClonedBytes;
+}
+
+/**
+ * @brief Set the metadata of a slot, keeping its cloned byte in sync.
+ */
+inline void SetMetadata(metadata_t* metadata, size_t capacity, size_t idex, metadata_t value) {
+    assert(idex < capacity);
+    metadata[idex] = value;
+    if (idex < NumClonedBytes) {
+        metadata[capacity + 1 + idex] = value;
+    }
+}
+
+/**
+ * @brief The sequence of group positions probed for a hash. Positions are taken over
+ * the control ring of capacity + 1 bytes (every slot plus the sentinel).
+ *
+ * With PowerOfTwo, the ring size must be a power of two. Positions are then masked
+ * and groups are probed triangularly (offsets 0, 1, 3, 6, ... groups), which visits
+ * every group of the ring exactly once. Otherwise, consecutive groups are probed.
+ */
+template <bool PowerOfTwo>
+class ProbeSeq {
+public:
+    ProbeSeq(size_t h1, size_t capacity)
+        : capacity_(capacity)
+        , offset_(wrap(h1)) {
+        if constexpr (PowerOfTwo) {
+            assert(((capacity + 1) & capacity) == 0 && "ring size must be a power of two");
         }
-        throw std::out_of_range("key not found");
     }
 
     /**
-     * @brief Insert a key-value pair into the HashMap. Returns the iterator to
-     * the inserted key-value pair, or std::nullopt if the key already has a value.
-     * 
-     * @param value Key-value pair to insert.
-     * @return Iterator or std::nullopt if already exists.
+     * @brief Get the position of the current group.
      */
-    std::optional<iterator> insert(const std::pair<K, V> &value) {
-        // Check if we need to grow
-        if (this->needRehashBeforeInsertion()) {
-            this->growOrRehash();
+    size_t offset() const {
+        return this->offset_;
+    }
+
+    /**
+     * @brief Get the slot index of position i within the current group.
+     */
+    size_t offset(size_t i) const {
+        if constexpr (PowerOfTwo) {
+            return (this->offset_ + i) & this->capacity_;
+        } else {
+            size_t idex = this->offset_ + i;
+            return idex > this->capacity_ ? idex - this->capacity_ - 1 : idex;
         }
-        // Perform the insert
-        return this->insertUnchecked(value);
     }
 
     /**
-     * @brief Insert a key-value pair into the HashMap. Returns the iterator to
-     * the inserted key-value pair, or std::nullopt if the key already has a value.
-     * 
-     * @param value Key-value pair to insert.
-     * @return Iterator or std::nullopt if already exists.
+     * @brief Advance to the next group.
      */
-    std::optional<iterator> insert(std::pair<K, V> &&value) {
-        // Check if we need to grow
-        if (this->needRehashBeforeInsertion()) {
-            this->growOrRehash();
+    void next() {
+        this->index_ += Group::Width;
+        if constexpr (PowerOfTwo) {
+            this->offset_ = wrap(this->offset_ + this->index_);
+        } else {
+            this->offset_ = wrap(this->offset_ + Group::Width);
+        }
+    }
+
+    /**
+     * @brief Get the distance probed so far, in slots.
+     */
+    size_t index() const {
+        return this->index_;
+    }
+
+private:
+    size_t wrap(size_t pos) const {
+        if constexpr (PowerOfTwo) {
+            return pos & this->capacity_;
+        } else {
+            return pos % (this->capacity_ + 1);
+        }
+    }
+
+    size_t capacity_;
+    size_t offset_;
+    size_t index_ = 0;
+};
+
+/**
+ * @brief Round a capacity up to the nearest 2^k - 1, so the control ring
+ * (capacity + 1) is a power of two.
+ */
+constexpr size_t NormalizeCapacity(size_t n) {
+    size_t capacity = 0;
+    while (capacity < n) {
+        capacity = capacity * 2 + 1;
+    }
+    return capacity;
+}
+
+static_assert(NormalizeCapacity(0) == 0, "Zero capacity should stay zero");
+static_assert(NormalizeCapacity(15) == 15, "2^k - 1 should be kept");
+static_assert(NormalizeCapacity(16) == 31, "Capacity should round up to 2^k - 1");
+
+/**
+ * @brief Check whether a hasher or equality functor declares is_transparent.
+ */
+template <typename T, typename = void>
+struct IsTransparent : std::false_type {};
+
+template <typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+/**
+ * @brief Check whether a policy still sets MaxDeletedLoadFactor, which meant
+ * the fraction of deleted slots a table tolerated before rehashing in place
+ * and was replaced by MinDeletedRehashFraction.
+ */
+template <typename Policy, typename = void>
+struct SetsMaxDeletedLoadFactor : std::false_type {};
+
+template <typename Policy>
+struct SetsMaxDeletedLoadFactor<Policy, std::void_t<decltype(Policy::MaxDeletedLoadFactor)>>
+    : std::true_type {};
+
+template <typename It, typename = void>
+struct IsIterator : std::false_type {};
+
+template <typename It>
+struct IsIterator<It, std::void_t<typename std::iterator_traits<It>::iterator_category>>
+    : std::true_type {};
+
+template <typename It>
+constexpr bool IsForwardIterator =
+    std::is_base_of_v<std::forward_iterator_tag,
+                      typename std::iterator_traits<It>::iterator_category>;
+
+/**
+ * @brief Select the key type accepted by lookups. Spelled as nested alias
+ * templates so that the lookup type stays deducible.
+ */
+template <bool Transparent>
+struct KeyArgImpl {
+    template <typename L, typename K>
+    using Type = K;
+};
+
+template <>
+struct KeyArgImpl<true> {
+    template <typename L, typename K>
+    using Type = L;
+};
+
+/**
+ * @brief Value type of a table that holds keys only, as HashSet does.
+ */
+struct SetValue {};
+
+/**
+ * @brief Layout of the elements of a table: a key-value pair for maps, and the
+ * key alone for sets.
+ */
+template <typename K, typename V>
+struct SlotTraits {
+    using Slot = std::pair<const K, V>;
+
+    static const K &key(const Slot &slot) {
+        return slot.first;
+    }
+};
+
+template <typename K>
+struct SlotTraits<K, SetValue> {
+    using Slot = K;
+
+    static const K &key(const Slot &slot) {
+        return slot;
+    }
+};
+
+/**
+ * @brief Slot storage that keeps elements inline in the slot array.
+ */
+template <typename Slot>
+struct FlatSlots {
+    using StoredSlot = Slot;
+
+    // Whole slot arrays can be copied as bytes, and left without destroying them
+    static constexpr bool TriviallyCopyable = std::is_trivially_copyable_v<Slot>;
+    static constexpr bool TriviallyDestructible = std::is_trivially_destructible_v<Slot>;
+
+    static Slot &element(StoredSlot &slot) {
+        return slot;
+    }
+
+    static const Slot &element(const StoredSlot &slot) {
+        return slot;
+    }
+
+    /**
+     * @brief Pointer to the element at an index, or one past the last element.
+     */
+    template <typename S>
+    static S* address(S* slots, size_t idex, size_t /* capacity */) {
+        return slots + idex;
+    }
+
+    template <typename Alloc, typename... Args>
+    static void construct(Alloc &alloc, StoredSlot* slot, Args &&...args) {
+        std::allocator_traits<Alloc>::construct(alloc, slot, std::forward<Args>(args)...);
+    }
+
+    template <typename Alloc>
+    static void destroy(Alloc &alloc, StoredSlot* slot) {
+        std::allocator_traits<Alloc>::destroy(alloc, slot);
+    }
+
+    /**
+     * @brief Move the element at src into dst and destroy the element at src.
+     */
+    template <typename Alloc>
+    static void transfer(Alloc &alloc, StoredSlot* dst, StoredSlot* src) {
+        if constexpr (IsTriviallyRelocatable<Slot>::value) {
+            std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), sizeof(Slot));
+        } else {
+            construct(alloc, dst, std::move(*src));
+            destroy(alloc, src);
+        }
+    }
+};
+
+/**
+ * @brief Slot storage that allocates every element in its own node and keeps
+ * pointers in the slot array. Elements never move, and moving a slot costs a
+ * pointer copy whatever the size of the element.
+ */
+template <typename Slot>
+struct NodeSlots {
+    using StoredSlot = Slot*;
+
+    // Every node must be copied and freed on its own
+    static constexpr bool TriviallyCopyable = false;
+    static constexpr bool TriviallyDestructible = false;
+
+    static Slot &element(StoredSlot slot) {
+        return *slot;
+    }
+
+    template <typename S>
+    static S address(const S* slots, size_t idex, size_t capacity) {
+        return idex < capacity ? slots[idex] : nullptr;
+    }
+
+    template <typename Alloc, typename... Args>
+    static void construct(Alloc &alloc, StoredSlot* slot, Args &&...args) {
+        using Traits = std::allocator_traits<Alloc>;
+        Slot* node = Traits::allocate(alloc, 1);
+        try {
+            Traits::construct(alloc, node, std::forward<Args>(args)...);
+        } catch (...) {
+            Traits::deallocate(alloc, node, 1);
+            throw;
+        }
+        *slot = node;
+    }
+
+    template <typename Alloc>
+    static void destroy(Alloc &alloc, StoredSlot* slot) {
+        using Traits = std::allocator_traits<Alloc>;
+        Traits::destroy(alloc, *slot);
+        Traits::deallocate(alloc, *slot, 1);
+    }
+
+    template <typename Alloc>
+    static void transfer(Alloc & /* alloc */, StoredSlot* dst, StoredSlot* src) {
+        *dst = *src;
+    }
+};
+
+// Alignment that keeps a slot array from sharing its first cache line with the metadata
+constexpr size_t CacheLineSize = 64;
+// Alignment that lets the kernel back a table with transparent huge pages
+constexpr size_t HugePageSize = 2 << 20;
+
+// NOLINTEND(readability-magic-numbers)
+
+/**
+ * @brief Holds a function object or allocator of a table. Empty ones are held
+ * as a base class so that they take no space. Tag tells holders of the same
+ * type apart.
+ */
+template <typename T, int Tag, bool = std::is_empty_v<T> && !std::is_final_v<T>>
+class FunctorHolder {
+public:
+    FunctorHolder() = default;
+
+    explicit FunctorHolder(const T &value)
+        : value_(value) {}
+
+    T &get() {
+        return this->value_;
+    }
+
+    const T &get() const {
+        return this->value_;
+    }
+
+private:
+    T value_;
+};
+
+template <typename T, int Tag>
+class FunctorHolder<T, Tag, true> : private T {
+public:
+    FunctorHolder() = default;
+
+    explicit FunctorHolder(const T &value)
+        : T(value) {}
+
+    T &get() {
+        return *this;
+    }
+
+    const T &get() const {
+        return *this;
+    }
+};
+
+/**
+ * @brief Statistics counters of a HashMap, empty unless Enabled.
+ */
+template <bool Enabled>
+struct StatsCounters {
+    void recordLookup(bool /* hit */, size_t /* groups */) const {}
+    void recordGrow() {}
+    void recordRehash() {}
+    void recordShrink() {}
+    template <typename Stats>
+    void fillStats(Stats & /* stats */) const {}
+};
+
+template <>
+struct StatsCounters<true> {
+    static constexpr size_t ProbeBuckets = 16;
+
+    StatsCounters() = default;
+
+    // Counters describe one object, and start over in copies
+    StatsCounters(const StatsCounters & /* other */) {}
+
+    StatsCounters &operator=(const StatsCounters & /* other */) {
+        return *this;
+    }
+
+    void recordLookup(bool hit, size_t groups) const {
+        auto &histogram = hit ? this->hitProbes_ : this->missProbes_;
+        histogram[std::min(groups, ProbeBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordGrow() {
+        this->grows_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordRehash() {
+        this->rehashes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordShrink() {
+        this->shrinks_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template <typename Stats>
+    void fillStats(Stats &stats) const {
+        static_assert(Stats::ProbeBuckets == ProbeBuckets);
+        for (size_t i = 0; i < ProbeBuckets; ++i) {
+            stats.hitProbes[i] = this->hitProbes_[i].load(std::memory_order_relaxed);
+            stats.missProbes[i] = this->missProbes_[i].load(std::memory_order_relaxed);
+        }
+        stats.grows = this->grows_.load(std::memory_order_relaxed);
+        stats.rehashes = this->rehashes_.load(std::memory_order_relaxed);
+        stats.shrinks = this->shrinks_.load(std::memory_order_relaxed);
+    }
+
+private:
+    mutable std::array<std::atomic<uint64_t>, ProbeBuckets> hitProbes_{};
+    mutable std::array<std::atomic<uint64_t>, ProbeBuckets> missProbes_{};
+    std::atomic<uint64_t> grows_{0};
+    std::atomic<uint64_t> rehashes_{0};
+    std::atomic<uint64_t> shrinks_{0};
+};
+
+} // namespace detail
+
+/**
+ * @brief Default HashMap policy. Tables keep the exact capacity they are given
+ * and probe consecutive groups.
+ */
+struct DefaultHashMapPolicy {
+    // Round capacities up to 2^k - 1 so that slot indices are masked instead of
+    // reduced with %, and probe groups triangularly.
+    static constexpr bool PowerOfTwoCapacity = false;
+    // Grow by migrating a bounded number of slots on each mutating operation
+    // instead of rehashing every element at once. Lookups consult both the old
+    // and the new table until the migration finishes.
+    static constexpr bool IncrementalResize = false;
+    // Number of old slots migrated per mutating operation during an incremental resize
+    static constexpr size_t MigrationBatchSize = 16;
+    // Alignment of a table's allocation and of its slot array, which follows the
+    // metadata in the same allocation. Raised to alignof(Slot) if smaller.
+    static constexpr size_t TableAlignment = alignof(std::max_align_t);
+    // Tables whose allocation is at least this many bytes are aligned to a huge
+    // page boundary instead. 0 disables huge page alignment.
+    static constexpr size_t HugePageThreshold = 0;
+    // Allocate every element in its own node and store pointers in the slots.
+    // Pointers and references to elements stay valid across rehashes.
+    static constexpr bool NodeStorage = false;
+    // Keep the full hash of every element next to the metadata, so that
+    // growing and rehashing never call the hasher. Costs a size_t per slot.
+    static constexpr bool StoreHash = false;
+    // Tables growing to at least this many slots rehash on every hardware
+    // thread, each moving the elements bound for one range of the new table.
+    // 0 disables parallel rehashing.
+    static constexpr size_t ParallelRehashThreshold = 0;
+    // Count probe lengths, grows and rehashes for stats(). Counters are relaxed
+    // atomics, so const lookups stay safe to run concurrently.
+    static constexpr bool CollectStats = false;
+    // Largest fraction of the slots that elements and deleted slots may fill
+    // before an insertion grows or rehashes the table. At most 1; one slot
+    // always stays empty.
+    static constexpr float MaxLoadFactor = 0.875f;
+    // Factor the capacity grows by when a table fills. Greater than 1.
+    static constexpr float GrowthFactor = 2;
+    // A full table whose used slots are at least this fraction deleted is
+    // rehashed in place instead of grown
+    static constexpr float MinDeletedRehashFraction = 0.125f;
+    // Shrink a table once erasures leave fewer than this fraction of its slots
+    // holding elements, down to half the max load factor. At most a quarter of
+    // MaxLoadFactor, so that each shrink is paid for by the erasures before it.
+    // 0 disables automatic shrinking.
+    static constexpr float ShrinkLoadFactor = 0;
+};
+
+/**
+ * @brief HashMap policy that collects statistics for stats().
+ */
+template <typename Policy = DefaultHashMapPolicy>
+struct StatsHashMapPolicy : Policy {
+    static constexpr bool CollectStats = true;
+};
+
+/**
+ * @brief Statistics of a HashMap, from HashMap::stats(). The counters are only
+ * collected with a CollectStats policy, and are zero otherwise.
+ */
+struct HashMapStats {
+    static constexpr size_t ProbeBuckets = 16;
+
+    // Lookups by the number of groups probed past the first. The last bucket
+    // also holds every longer probe.
+    std::array<uint64_t, ProbeBuckets> hitProbes{};
+    std::array<uint64_t, ProbeBuckets> missProbes{};
+    // Rehashes into a larger table, including incremental ones
+    uint64_t grows = 0;
+    // Rehashes in place to drop deleted slots
+    uint64_t rehashes = 0;
+    // Rehashes into a smaller table
+    uint64_t shrinks = 0;
+
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t deletedCount = 0;
+    // Bytes of every table and node currently allocated
+    size_t bytesAllocated = 0;
+    float effectiveLoadFactor = 0;
+
+    /**
+     * @brief Report every statistic to a metrics pipeline.
+     *
+     * @param f Called as f(std::string_view name, double value) for each
+     * statistic. Histogram buckets are named like "hit_probe_groups.3".
+     */
+    template <typename F>
+    void export_metrics(F &&f) const {
+        for (size_t i = 0; i < ProbeBuckets; ++i) {
+            f(std::string("hit_probe_groups.") + std::to_string(i),
+              static_cast<double>(this->hitProbes[i]));
+        }
+        for (size_t i = 0; i < ProbeBuckets; ++i) {
+            f(std::string("miss_probe_groups.") + std::to_string(i),
+              static_cast<double>(this->missProbes[i]));
+        }
+        f(std::string_view("grows"), static_cast<double>(this->grows));
+        f(std::string_view("rehashes"), static_cast<double>(this->rehashes));
+        f(std::string_view("shrinks"), static_cast<double>(this->shrinks));
+        f(std::string_view("size"), static_cast<double>(this->size));
+        f(std::string_view("capacity"), static_cast<double>(this->capacity));
+        f(std::string_view("deleted"), static_cast<double>(this->deletedCount));
+        f(std::string_view("bytes_allocated"), static_cast<double>(this->bytesAllocated));
+        f(std::string_view("effective_load_factor"),
+          static_cast<double>(this->effectiveLoadFactor));
+    }
+};
+
+/**
+ * @brief HashMap policy that rounds capacities up to 2^k - 1 and probes groups
+ * triangularly. Avoids a division per probe and primary clustering on hot keys.
+ */
+struct PowerOfTwoHashMapPolicy : DefaultHashMapPolicy {
+    static constexpr bool PowerOfTwoCapacity = true;
+};
+
+/**
+ * @brief HashMap policy that grows incrementally, bounding the cost of every
+ * insertion to O(1) slot moves instead of a full rehash.
+ */
+struct IncrementalHashMapPolicy : DefaultHashMapPolicy {
+    static constexpr bool IncrementalResize = true;
+};
+
+/**
+ * @brief HashMap policy for large tables. Metadata and slots start on cache line
+ * boundaries, and tables of a huge page or more are aligned to huge pages.
+ */
+struct LargeTableHashMapPolicy : DefaultHashMapPolicy {
+    static constexpr size_t TableAlignment = detail::CacheLineSize;
+    static constexpr size_t HugePageThreshold = detail::HugePageSize;
+};
+
+/**
+ * @brief Make a HashMap policy shrink tables automatically once erasures leave
+ * them an eighth as full as they may grow.
+ */
+template <typename Policy = DefaultHashMapPolicy>
+struct ShrinkingHashMapPolicy : Policy {
+    static constexpr float ShrinkLoadFactor = Policy::MaxLoadFactor / 8;
+};
+
+/**
+ * @brief Add node storage to a HashMap policy.
+ */
+template <typename Policy = DefaultHashMapPolicy>
+struct NodeHashMapPolicy : Policy {
+    static constexpr bool NodeStorage = true;
+};
+
+namespace detail {
+
+/**
+ * @brief Header of a snapshot file written by HashMap::save(). The table's
+ * metadata and stored hashes follow the header, and the slot array starts at
+ * slotsOffset. Fields are in native byte order.
+ */
+struct SnapshotHeader {
+    static constexpr char Magic[8] = {'D', 'N', 'S', 'G', 'E', 'H', 'M', '\0'};
+    static constexpr uint32_t LayoutVersion = 2;
+    // Bits of flags, for the policy knobs that change the layout
+    static constexpr uint32_t PowerOfTwoCapacityFlag = 1;
+    static constexpr uint32_t StoreHashFlag = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t deletedCount;
+    // Seed of the hasher the table was built with, 0 for hashers without one
+    uint64_t hashSeed;
+    uint32_t groupWidth;
+    uint32_t slotSize;
+    uint32_t slotAlignment;
+    uint32_t reserved;
+    // Bytes of metadata and stored hashes
+    uint64_t metadataBytes;
+    uint64_t slotsOffset;
+
+    template <typename Policy>
+    static constexpr uint32_t flagsOf() {
+        return (Policy::PowerOfTwoCapacity ? PowerOfTwoCapacityFlag : 0) |
+               (Policy::StoreHash ? StoreHashFlag : 0);
+    }
+};
+
+} // namespace detail
+
+template <typename K, typename V, typename Hash, typename Eq, typename Policy>
+class MappedHashMap;
+
+template <typename K, typename Hash, typename Eq, typename Policy, typename Allocator>
+class HashSet;
+
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy,
+    typename Allocator = std::allocator<std::pair<const K, V>>>
+class HashMap : private detail::StatsCounters<Policy::CollectStats>,
+                private detail::FunctorHolder<Hash, 0>,
+                private detail::FunctorHolder<Eq, 1> {
+    static_assert(detail::IsPowerOfTwo(Policy::TableAlignment),
+                  "TableAlignment must be a power of two");
+    static_assert(Policy::MaxLoadFactor > 0 && Policy::MaxLoadFactor <= 1,
+                  "MaxLoadFactor must be in (0, 1]");
+    static_assert(Policy::GrowthFactor > 1, "GrowthFactor must be greater than 1");
+    static_assert(Policy::MinDeletedRehashFraction >= 0 && Policy::MinDeletedRehashFraction <= 1,
+                  "MinDeletedRehashFraction must be in [0, 1]");
+    static_assert(!detail::SetsMaxDeletedLoadFactor<Policy>::value,
+                  "MaxDeletedLoadFactor is replaced by MinDeletedRehashFraction, the fraction "
+                  "of used slots that must be deleted for a full table to rehash in place");
+    static_assert(Policy::ShrinkLoadFactor >= 0 &&
+                      Policy::ShrinkLoadFactor * 4 <= Policy::MaxLoadFactor,
+                  "ShrinkLoadFactor must be in [0, MaxLoadFactor / 4]");
+
+public:
+    static constexpr size_t DefaultInitialCapacity = 16;
+    // Defaults of the tuning, which each HashMap can override at runtime
+    static constexpr float MaxLoadFactor = Policy::MaxLoadFactor;
+    static constexpr float MinDeletedRehashFraction = Policy::MinDeletedRehashFraction;
+    static constexpr float GrowthFactor = Policy::GrowthFactor;
+    static constexpr float ShrinkLoadFactor = Policy::ShrinkLoadFactor;
+
+    using Slot = typename detail::SlotTraits<K, V>::Slot;
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = Slot;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using allocator_type = Allocator;
+
+private:
+    using AllocTraits = std::allocator_traits<Allocator>;
+    using SlotAlloc = typename AllocTraits::template rebind_alloc<Slot>;
+    using Storage =
+        std::conditional_t<Policy::NodeStorage, detail::NodeSlots<Slot>, detail::FlatSlots<Slot>>;
+    // What the slot array holds: the element itself, or a pointer to its node
+    using StoredSlot = typename Storage::StoredSlot;
+    // Metadata bytes followed by the slot array, in one allocation
+    using Table = TableStorage<StoredSlot, SlotAlloc>;
+
+public:
+    static_assert(std::is_copy_assignable_v<K>, "Key must be copy assignable");
+    static_assert(Policy::NodeStorage || std::is_move_constructible_v<Slot>,
+                  "Slot must be move constructable");
+
+    /**
+     * @brief Forward iterator over the elements of a HashMap. Inserting or erasing
+     * elements invalidates every iterator.
+     */
+    template <typename SlotType>
+    class MapIterator {
+    private:
+        using MapType = std::conditional_t<std::is_const_v<SlotType>, const HashMap, HashMap>;
+
+        MapIterator(size_t idex, SlotType* slotPtr, MapType* map)
+            : idex_(idex)
+            , slotPtr_(slotPtr)
+            , map_(map) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<SlotType>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = SlotType*;
+        using reference = SlotType &;
+
+        MapIterator()
+            : idex_(0)
+            , slotPtr_(nullptr)
+            , map_(nullptr) {}
+
+        /**
+         * @brief Convert an iterator to a const_iterator.
+         */
+        template <typename OtherSlot,
+                  typename = std::enable_if_t<std::is_same_v<const OtherSlot, SlotType> &&
+                                              !std::is_same_v<OtherSlot, SlotType>>>
+        MapIterator(const MapIterator<OtherSlot> &other)
+            : idex_(other.idex_)
+            , slotPtr_(other.slotPtr_)
+            , map_(other.map_) {}
+
+        MapIterator &operator++() {
+            this->idex_ = this->map_->nextFull(this->idex_ + 1);
+            this->slotPtr_ = this->map_->slotAddress(this->idex_);
+            return *this;
+        }
+
+        MapIterator operator++(int) {
+            MapIterator prev = *this;
+            ++*this;
+            return prev;
+        }
+
+        SlotType &operator*() const {
+            return *this->slotPtr_;
+        }
+
+        SlotType* operator->() const {
+            return this->slotPtr_;
+        }
+
+        bool operator==(const MapIterator &other) const {
+            return this->idex_ == other.idex_;
+        }
+
+        bool operator!=(const MapIterator &other) const {
+            return this->idex_ != other.idex_;
+        }
+
+    private:
+        friend class HashMap<K, V, Hash, Eq, Policy, Allocator>;
+        template <typename OtherSlot>
+        friend class MapIterator;
+        size_t idex_;
+        SlotType* slotPtr_;
+        MapType* map_;
+    };
+
+    using iterator = MapIterator<Slot>;
+    using const_iterator = MapIterator<const Slot>;
+
+    /**
+     * @brief An element taken out of a HashMap by extract(), which owns it until
+     * it is inserted into a HashMap of the same type with an equal allocator.
+     * The element is moved rather than copied in and out, and with node storage
+     * it never moves at all. Keeps the hash of its key, so that inserting it into
+     * a HashMap whose hasher hashes alike skips the hasher.
+     */
+    class node_type {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = Slot;
+        using allocator_type = Allocator;
+
+        node_type() = default;
+
+        node_type(node_type &&other) noexcept {
+            this->takeFrom(other);
+        }
+
+        node_type &operator=(node_type &&other) noexcept {
+            if (this != &other) {
+                this->reset();
+                this->takeFrom(other);
+            }
+            return *this;
+        }
+
+        node_type(const node_type &other) = delete;
+        node_type &operator=(const node_type &other) = delete;
+
+        ~node_type() {
+            this->reset();
+        }
+
+        bool empty() const {
+            return !this->alloc_;
+        }
+
+        explicit operator bool() const {
+            return !this->empty();
+        }
+
+        const K &key() const {
+            return keyOf(this->value());
+        }
+
+        template <typename U = V, typename = std::enable_if_t<!std::is_same_v<U, detail::SetValue>>>
+        U &mapped() const {
+            return this->value().second;
+        }
+
+        value_type &value() const {
+            assert(!this->empty());
+            return Storage::element(*this->stored());
+        }
+
+        allocator_type get_allocator() const {
+            return allocator_type(*this->alloc_);
+        }
+
+    private:
+        friend class HashMap<K, V, Hash, Eq, Policy, Allocator>;
+
+        StoredSlot* stored() const {
+            auto* bytes = const_cast<unsigned char*>(this->storage_);
+            return std::launder(reinterpret_cast<StoredSlot*>(bytes));
+        }
+
+        void takeFrom(node_type &other) {
+            if (other.empty()) {
+                return;
+            }
+            this->alloc_.emplace(std::move(*other.alloc_));
+            Storage::transfer(*this->alloc_, this->stored(), other.stored());
+            this->hash_ = other.hash_;
+            this->hashSeed_ = other.hashSeed_;
+            other.alloc_.reset();
+        }
+
+        void reset() {
+            if (this->alloc_) {
+                Storage::destroy(*this->alloc_, this->stored());
+                this->alloc_.reset();
+            }
+        }
+
+        alignas(StoredSlot) unsigned char storage_[sizeof(StoredSlot)];
+        // Engaged exactly while the node holds an element
+        std::optional<SlotAlloc> alloc_;
+        // Mixed hash of the key, and HashSeedOf() the hasher that computed it
+        size_t hash_ = 0;
+        uint64_t hashSeed_ = 0;
+    };
+
+    /**
+     * @brief Key type accepted by lookups. When both Hash and Eq are transparent,
+     * any type they accept can be looked up without constructing a K.
+     */
+    static constexpr bool IsTransparent =
+        detail::IsTransparent<Hash>::value && detail::IsTransparent<Eq>::value;
+
+    template <typename L>
+    using KeyArg = typename detail::KeyArgImpl<IsTransparent>::template Type<L, K>;
+
+    /**
+     * @brief Construct a new HashMap with a default capacity.
+     */
+    HashMap()
+        : HashMap(DefaultInitialCapacity) {}
+
+    /**
+     * @brief Construct a new HashMap with a default capacity, allocating from an allocator.
+     *
+     * @param alloc Allocator for all of the HashMap's storage.
+     */
+    explicit HashMap(const Allocator &alloc)
+        : HashMap(DefaultInitialCapacity, alloc) {}
+
+    /**
+     * @brief Construct a new HashMap with a specified capacity. With a
+     * PowerOfTwoCapacity policy, the capacity is rounded up to 2^k - 1.
+     * 
+     * @param initialCapacity Initial slot capacity.
+     * @param alloc Allocator for all of the HashMap's storage.
+     */
+    HashMap(size_t initialCapacity, const Allocator &alloc = Allocator())
+        : HashMap(initialCapacity, Hash(), Eq(), alloc) {}
+
+    /**
+     * @brief Construct a new HashMap with a specified capacity and the function
+     * objects to hash and compare keys with, such as a SeededHash.
+     *
+     * @param initialCapacity Initial slot capacity.
+     * @param hash Hash function, copied into the HashMap.
+     * @param eq Key equality function, copied into the HashMap.
+     * @param alloc Allocator for all of the HashMap's storage.
+     */
+    HashMap(size_t initialCapacity,
+            const Hash &hash,
+            const Eq &eq = Eq(),
+            const Allocator &alloc = Allocator())
+        : HasherHolder(hash)
+        , EqHolder(eq)
+        , capacity_(normalizeCapacity(initialCapacity))
+        , size_(0)
+        , table_(makeTable(capacity_, alloc))
+        , deletedCount_(0) {
+        this->resetMetadata();
+    }
+
+    /**
+     * @brief Construct a new HashMap holding the elements of a range. See
+     * bulk_insert().
+     *
+     * @param first Iterator to the first key-value pair.
+     * @param last Iterator past the last key-value pair.
+     * @param initialCapacity Initial slot capacity, grown once to fit the range.
+     * @param alloc Allocator for all of the HashMap's storage.
+     */
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    HashMap(InputIt first,
+            InputIt last,
+            size_t initialCapacity = DefaultInitialCapacity,
+            const Allocator &alloc = Allocator())
+        : HashMap(initialCapacity, alloc) {
+        this->bulk_insert(first, last);
+    }
+
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    HashMap(InputIt first,
+            InputIt last,
+            size_t initialCapacity,
+            const Hash &hash,
+            const Eq &eq = Eq(),
+            const Allocator &alloc = Allocator())
+        : HashMap(initialCapacity, hash, eq, alloc) {
+        this->bulk_insert(first, last);
+    }
+
+    ~HashMap() {
+        this->destroySlots();
+        this->resetOldTable();
+    }
+
+    HashMap(const HashMap &other)
+        : HashMap(other,
+                  AllocTraits::select_on_container_copy_construction(other.get_allocator())) {}
+
+    /**
+     * @brief Copy a HashMap into storage from a different allocator.
+     */
+    HashMap(const HashMap &other, const Allocator &alloc)
+        : HasherHolder(other.hashRef())
+        , EqHolder(other.eqRef())
+        , capacity_(other.capacity_)
+        , size_(other.size_)
+        , table_(makeTable(other.capacity_, alloc))
+        , deletedCount_(other.deletedCount_)
+        , tuning_(other.tuning_)
+        , growthLimit_(other.growthLimit_)
+        , shrinkLimit_(other.shrinkLimit_) {
+        if (other.table_.numBytes() == 0) {
+            // Moved-from HashMap
+            this->resetMetadata();
+        } else {
+            // Metadata and stored hashes
+            std::copy_n(other.metadata(), other.table_.numBytes(), this->metadata());
+        }
+        if (this->empty()) {
+            return;
+        }
+        if constexpr (Storage::TriviallyCopyable) {
+            // Copy the slot array in bulk, free slots included
+            std::memcpy(static_cast<void*>(this->slots()),
+                        static_cast<const void*>(other.slots()),
+                        this->capacity_ * sizeof(StoredSlot));
+        } else {
+            for (size_t i = 0; i < this->capacity_; ++i) {
+                if (!detail::IsFree(this->metadata()[i])) {
+                    // Copy slot entry
+                    this->constructElement(&this->slots()[i], other.element(i));
+                }
+            }
+        }
+        if (other.old_) {
+            // Finish the other table's migration in the copy
+            for (size_t i = other.old_->cursor; i < other.old_->capacity; ++i) {
+                if (!detail::IsFree(other.old_->metadata()[i])) {
+                    this->insertNew(other.old_->hashAt(i, other), other.old_->element(i));
+                }
+            }
+        }
+    }
+
+    HashMap &operator=(const HashMap &other) {
+        if (this != &other) {
+            Allocator alloc = AllocTraits::propagate_on_container_copy_assignment::value
+                                  ? other.get_allocator()
+                                  : this->get_allocator();
+            HashMap temp(other, alloc);
+            this->assignFrom(std::move(temp));
+        }
+        return *this;
+    }
+
+    HashMap(HashMap &&other) noexcept
+        : HasherHolder(std::move(other.hashRef()))
+        , EqHolder(std::move(other.eqRef()))
+        , capacity_(other.capacity_)
+        , size_(other.size_)
+        , table_(std::move(other.table_))
+        , deletedCount_(other.deletedCount_)
+        , old_(other.old_)
+        , tuning_(other.tuning_)
+        , growthLimit_(other.growthLimit_)
+        , shrinkLimit_(other.shrinkLimit_) {
+        other.old_ = nullptr;
+        other.capacity_ = 0;
+        other.size_ = 0;
+        other.deletedCount_ = 0;
+        other.updateLimits();
+    }
+
+    HashMap &operator=(HashMap &&other) noexcept(
+        AllocTraits::propagate_on_container_move_assignment::value ||
+        AllocTraits::is_always_equal::value) {
+        if (this == &other) {
+            return *this;
+        }
+        if constexpr (!AllocTraits::propagate_on_container_move_assignment::value &&
+                      !AllocTraits::is_always_equal::value) {
+            if (this->get_allocator() != other.get_allocator()) {
+                // Storage cannot change hands, so move the elements into our own instead
+                HashMap temp = other.emptyLike(other.capacity_, this->get_allocator());
+                other.moveElementsInto(temp);
+                this->assignFrom(std::move(temp));
+                return *this;
+            }
+        }
+        this->assignFrom(std::move(other));
+        return *this;
+    }
+
+    /**
+     * @brief Get the hash function of the HashMap, for computing the hashes
+     * taken by find(), contains() and insert_hashed().
+     */
+    hasher hash_function() const {
+        return this->hashRef();
+    }
+
+    /**
+     * @brief Get the key equality function of the HashMap.
+     */
+    key_equal key_eq() const {
+        return this->eqRef();
+    }
+
+    /**
+     * @brief Get the statistics of the HashMap. Probe and rehash counters are
+     * collected only with a CollectStats policy, such as StatsHashMapPolicy.
+     */
+    HashMapStats stats() const {
+        HashMapStats stats;
+        this->fillStats(stats);
+        stats.size = this->size_;
+        stats.capacity = this->capacity_;
+        stats.deletedCount = this->deletedCount_;
+        stats.bytesAllocated = this->table_.allocatedBytes();
+        if (this->old_) {
+            stats.bytesAllocated += sizeof(OldTable) + this->old_->table.allocatedBytes();
+        }
+        if constexpr (Policy::NodeStorage) {
+            stats.bytesAllocated += this->size_ * sizeof(Slot);
+        }
+        stats.effectiveLoadFactor = this->capacity_ == 0 ? 0 : this->effectiveLoadFactor();
+        return stats;
+    }
+
+    /**
+     * @brief Get the allocator of the HashMap.
+     */
+    allocator_type get_allocator() const {
+        return allocator_type(this->table_.get_allocator());
+    }
+
+private:
+    /**
+     * @brief Take over the storage of another HashMap whose allocator is equal
+     * to ours, or propagates.
+     */
+    void assignFrom(HashMap &&other) noexcept {
+        // Destroy our own elements before taking over the other table
+        this->destroySlots();
+        this->resetOldTable();
+        this->hashRef() = std::move(other.hashRef());
+        this->eqRef() = std::move(other.eqRef());
+        this->capacity_ = other.capacity_;
+        this->size_ = other.size_;
+        this->table_ = std::move(other.table_);
+        this->deletedCount_ = other.deletedCount_;
+        this->old_ = other.old_;
+        this->tuning_ = other.tuning_;
+        this->growthLimit_ = other.growthLimit_;
+        this->shrinkLimit_ = other.shrinkLimit_;
+        other.old_ = nullptr;
+        other.capacity_ = 0;
+        other.size_ = 0;
+        other.deletedCount_ = 0;
+        other.updateLimits();
+    }
+
+    /**
+     * @brief Make an empty HashMap with the function objects and tuning of this one.
+     */
+    HashMap emptyLike(size_t capacity, const Allocator &alloc) const {
+        HashMap map(capacity, this->hashRef(), this->eqRef(), alloc);
+        map.tuning_ = this->tuning_;
+        map.updateLimits();
+        return map;
+    }
+
+    /**
+     * @brief Move every element into an empty HashMap with enough capacity,
+     * leaving this HashMap empty.
+     */
+    void moveElementsInto(HashMap &target) {
+        this->finishMigration();
+        for (size_t i = 0; i < this->capacity_ && !this->empty(); ++i) {
+            if (!detail::IsFree(this->metadata()[i])) {
+                target.insertNew(this->hashAt(i), std::move(this->element(i)));
+                ++target.size_;
+                this->destroySlot(i);
+                --this->size_;
+            }
+        }
+    }
+
+public:
+
+    /**
+     * @brief Find a key-value pair in the HashMap.
+     * 
+     * @param key Key to look up.
+     * @return Iterator to the element, or end() if not found.
+     */
+    template <typename L = K>
+    iterator find(const KeyArg<L> &key) {
+        return this->iteratorAt(this->findIndex(key, this->hashKey(key)));
+    }
+
+    /**
+     * @brief Find a key-value pair in the HashMap, given the hash of the key.
+     * Skips the hasher when the hash is already known, e.g. from another map.
+     * 
+     * @param key Key to look up.
+     * @param hash hash_function() of the key.
+     * @return Iterator to the element, or end() if not found.
+     */
+    template <typename L = K>
+    iterator find(const KeyArg<L> &key, size_t hash) {
+        assert(hash == this->hashRef()(key));
+        return this->iteratorAt(this->findIndex(key, mixHash(hash)));
+    }
+
+    /**
+     * @brief Find a key-value pair in the HashMap.
+     * 
+     * @param key Key to look up.
+     * @return Iterator to the element, or end() if not found.
+     */
+    template <typename L = K>
+    const_iterator find(const KeyArg<L> &key) const {
+        return this->findConst(key, this->hashKey(key));
+    }
+
+    /**
+     * @brief Find a key-value pair in the HashMap, given the hash of the key.
+     * 
+     * @param key Key to look up.
+     * @param hash hash_function() of the key.
+     * @return Iterator to the element, or end() if not found.
+     */
+    template <typename L = K>
+    const_iterator find(const KeyArg<L> &key, size_t hash) const {
+        assert(hash == this->hashRef()(key));
+        return this->findConst(key, mixHash(hash));
+    }
+
+    /**
+     * @brief Check whether a key is present in the HashMap.
+     * 
+     * @param key Key to look for.
+     */
+    template <typename L = K>
+    bool contains(const KeyArg<L> &key) const {
+        return this->containsHashed(key, this->hashKey(key));
+    }
+
+    /**
+     * @brief Check whether a key is present in the HashMap, given the hash of the key.
+     * 
+     * @param key Key to look for.
+     * @param hash hash_function() of the key.
+     */
+    template <typename L = K>
+    bool contains(const KeyArg<L> &key, size_t hash) const {
+        assert(hash == this->hashRef()(key));
+        return this->containsHashed(key, mixHash(hash));
+    }
+
+    /**
+     * @brief Hint that a key is about to be looked up, so that the start of its
+     * probe sequence is fetched into the cache in the meantime.
+     *
+     * @param key Key that will be looked up.
+     */
+    template <typename L = K>
+    void prefetch(const KeyArg<L> &key) const {
+        this->prefetchHash(this->hashKey(key));
+    }
+
+    /**
+     * @brief Find many keys at once. All keys of a batch are hashed and their
+     * probe sequences prefetched before any is resolved, so that cache misses
+     * on large tables overlap instead of stalling one after the other.
+     *
+     * @param first Start of the keys to look up.
+     * @param last End of the keys to look up.
+     * @param out Receives an iterator to each element, or end(), in key order.
+     * @return Output iterator past the last result.
+     */
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+        return this->lookupBatch(first, last, out, [this](const auto &key, size_t hash) {
+            return this->iteratorAt(this->findIndex(key, hash));
+        });
+    }
+
+    /**
+     * @brief Find many keys at once. See the non-const find_batch().
+     */
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        return this->lookupBatch(first, last, out, [this](const auto &key, size_t hash) {
+            return this->findConst(key, hash);
+        });
+    }
+
+    /**
+     * @brief Check whether many keys are present at once, overlapping their
+     * cache misses like find_batch().
+     *
+     * @param first Start of the keys to look for.
+     * @param last End of the keys to look for.
+     * @param out Receives whether each key is present, in key order.
+     * @return Output iterator past the last result.
+     */
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt contains_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        return this->lookupBatch(first, last, out, [this](const auto &key, size_t hash) {
+            return this->containsHashed(key, hash);
+        });
+    }
+
+    /**
+     * @brief Get the value of a key in the HashMap. Throws std::out_of_range if
+     * the key is not in the HashMap.
+     *
+     * @param key Key to look up.
+     * @return Reference to found value.
+     */
+    template <typename L = K>
+    V &at(const KeyArg<L> &key) {
+        auto res = this->findIndex(key, this->hashKey(key));
+        if (res) {
+            return this->slotAddress(res.value())->second;
+        }
+        throw std::out_of_range("key not found");
+    }
+
+    template <typename L = K>
+    const V &at(const KeyArg<L> &key) const {
+        auto it = this->find(key);
+        if (it != this->end()) {
+            return it->second;
+        }
+        throw std::out_of_range("key not found");
+    }
+
+    /**
+     * @brief Insert a key-value pair into the HashMap. Returns the iterator to
+     * the inserted key-value pair, or std::nullopt if the key already has a value.
+     * 
+     * @param value Key-value pair to insert.
+     * @return Iterator or std::nullopt if already exists.
+     */
+    std::optional<iterator> insert(const std::pair<K, V> &value) {
+        return this->insert_hashed(value, this->hashRef()(value.first));
+    }
+
+    /**
+     * @brief Insert a key-value pair whose key hash is already known. See insert().
+     * 
+     * @param value Key-value pair to insert.
+     * @param hash hash_function() of the key.
+     * @return Iterator or std::nullopt if already exists.
+     */
+    std::optional<iterator> insert_hashed(const std::pair<K, V> &value, size_t hash) {
+        auto loc = this->findOrPrepareInsert(value.first, mixHash(hash));
+        if (!loc.free) {
+            return std::nullopt;
+        }
+        return this->constructAt(loc, value.first, value.second);
+    }
+
+    /**
+     * @brief Insert a key-value pair into the HashMap. Returns the iterator to
+     * the inserted key-value pair, or std::nullopt if the key already has a value.
+     * 
+     * @param value Key-value pair to insert.
+     * @return Iterator or std::nullopt if already exists.
+     */
+    std::optional<iterator> insert(std::pair<K, V> &&value) {
+        return this->insert_hashed(std::move(value), this->hashRef()(value.first));
+    }
+
+    /**
+     * @brief Insert a key-value pair whose key hash is already known. See insert().
+     * 
+     * @param value Key-value pair to insert.
+     * @param hash hash_function() of the key.
+     * @return Iterator or std::nullopt if already exists.
+     */
+    std::optional<iterator> insert_hashed(std::pair<K, V> &&value, size_t hash) {
+        return this->insertMixed(std::move(value), mixHash(hash));
+    }
+
+    /**
+     * @brief Insert the key-value pairs of a range whose keys are not present
+     * yet. Of several pairs with the same key, the first is inserted.
+     *
+     * With forward iterators, the table grows at most once to fit the whole
+     * range, and the pairs are inserted in the order of the groups they hash to
+     * so that writes to the table go out roughly sequentially.
+     *
+     * @param first Iterator to the first key-value pair.
+     * @param last Iterator past the last key-value pair.
+     * @return Number of pairs inserted.
+     */
+    template <typename InputIt>
+    size_t bulk_insert(InputIt first, InputIt last) {
+        return this->bulk_insert(first, last, ThreadExecutor(1));
+    }
+
+    /**
+     * @brief Insert the key-value pairs of a range, hashing the keys on an
+     * executor. See bulk_insert(first, last).
+     *
+     * @param first Iterator to the first key-value pair.
+     * @param last Iterator past the last key-value pair.
+     * @param executor Executor to hash keys on, such as a ThreadExecutor.
+     * @return Number of pairs inserted.
+     */
+    template <typename InputIt, typename Executor>
+    size_t bulk_insert(InputIt first, InputIt last, Executor &&executor) {
+        size_t inserted = 0;
+        if constexpr (!detail::IsForwardIterator<InputIt>) {
+            // Single pass ranges cannot be measured up front
+            static_cast<void>(executor);
+            for (; first != last; ++first) {
+                inserted += this->insert(std::pair<K, V>(*first)).has_value();
+            }
+        } else {
+            struct Entry {
+                InputIt it;
+                size_t hash;
+            };
+            std::vector<Entry> entries;
+            entries.reserve(static_cast<size_t>(std::distance(first, last)));
+            for (; first != last; ++first) {
+                entries.push_back({first, 0});
+            }
+            this->reserve(this->size_ + entries.size());
+
+            size_t numTasks =
+                std::clamp<size_t>(entries.size() / BulkHashChunkSize, 1, MaxParallelRehashTasks);
+            executor(numTasks, [&](size_t t) {
+                size_t end = (t + 1) * entries.size() / numTasks;
+                for (size_t k = t * entries.size() / numTasks; k < end; ++k) {
+                    entries[k].hash = this->hashKey((*entries[k].it).first);
+                }
+            });
+
+            if (entries.size() >= this->capacity_ / detail::Group::Width) {
+                // Counting sort by home group, worth its counts only when
+                // there are about as many entries as groups
+                auto groupOf = [&](size_t hash) {
+                    return ProbeSeq(detail::H1(hash), this->capacity_).offset() /
+                           detail::Group::Width;
+                };
+                std::vector<size_t> starts(this->capacity_ / detail::Group::Width + 2, 0);
+                for (const Entry &entry : entries) {
+                    ++starts[groupOf(entry.hash) + 1];
+                }
+                std::partial_sum(starts.begin(), starts.end(), starts.begin());
+                std::vector<Entry> sorted(entries.size());
+                for (const Entry &entry : entries) {
+                    sorted[starts[groupOf(entry.hash)]++] = entry;
+                }
+                entries = std::move(sorted);
+            }
+
+            for (const Entry &entry : entries) {
+                inserted += this->insertMixed(std::pair<K, V>(*entry.it), entry.hash).has_value();
+            }
+        }
+        return inserted;
+    }
+
+    /**
+     * @brief Construct a key-value pair in place from args, as if by
+     * std::pair<const K, V>(args...). When the key and value are passed
+     * separately or as a pair, nothing is constructed if the key already exists.
+     *
+     * @param args Arguments to construct the key-value pair from.
+     * @return Iterator to the element with the key, and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&...args) {
+        return this->emplaceImpl(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Insert a value constructed in place from args if the key is not
+     * present. Nothing is constructed if the key already exists.
+     *
+     * @param key Key to insert.
+     * @param args Arguments to construct the value from.
+     * @return Iterator to the element with the key, and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K &key, Args &&...args) {
+        return this->tryEmplaceImpl(key, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Insert a value constructed in place from args if the key is not
+     * present. Nothing is constructed, and the key is not moved from, if the key
+     * already exists.
+     *
+     * @param key Key to insert.
+     * @param args Arguments to construct the value from.
+     * @return Iterator to the element with the key, and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+        return this->tryEmplaceImpl(std::move(key), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Insert a key-value pair, or assign the value if the key already exists.
+     *
+     * @param key Key to insert or assign.
+     * @param obj Value to insert or assign.
+     * @return Iterator to the element with the key, and whether it was inserted.
+     */
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const K &key, M &&obj) {
+        return this->insertOrAssignImpl(key, std::forward<M>(obj));
+    }
+
+    /**
+     * @brief Insert a key-value pair, or assign the value if the key already exists.
+     *
+     * @param key Key to insert or assign.
+     * @param obj Value to insert or assign.
+     * @return Iterator to the element with the key, and whether it was inserted.
+     */
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(K &&key, M &&obj) {
+        return this->insertOrAssignImpl(std::move(key), std::forward<M>(obj));
+    }
+
+    /**
+     * @brief Get the value of a key in the HashMap. If the key is not present,
+     * a default-constructed value is first inserted.
+     * 
+     * @param key Key to look up.
+     * @return Reference to the value.
+     */
+    template <typename L = K, typename U = V>
+    typename std::enable_if_t<std::is_default_constructible_v<U>, V &> operator[](
+        const KeyArg<L> &key) {
+        return this->tryEmplaceImpl(key).first->second;
+    }
+
+    /**
+     * @brief Get the value of a key in the HashMap. If the key is not present,
+     * a default-constructed value is first inserted, moving the key.
+     * 
+     * @param key Key to look up.
+     * @return Reference to the value.
+     */
+    template <typename U = V>
+    typename std::enable_if_t<std::is_default_constructible_v<U>, V &> operator[](K &&key) {
+        return this->tryEmplaceImpl(std::move(key)).first->second;
+    }
+
+    /**
+     * @brief Erase the key-value pair at an iterator. Returns whether the
+     * key-value pair was successfully removed. With a shrink load factor, the
+     * HashMap may shrink, invalidating every iterator.
+     * 
+     * @param it Iterator to delete
+     * @return Whether the key-value pair was found and removed. 
+     */
+    bool erase(iterator it) {
+        if (it == this->end()) {
+            return false;
+        }
+        this->eraseAt(it.idex_);
+        if (this->shrinkIfSparse()) {
+            return true;
+        }
+
+        if constexpr (Policy::IncrementalResize) {
+            this->migrateStep();
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Erase the key-value pairs of an iterator range in one sweep. The
+     * HashMap shrinks at most once, at the end, and only with a shrink load
+     * factor.
+     *
+     * @param first Iterator to the first key-value pair to erase.
+     * @param last Iterator past the last key-value pair to erase.
+     * @return Number of key-value pairs erased.
+     */
+    size_t erase(const_iterator first, const_iterator last) {
+        size_t erased = 0;
+        for (; first != last; ++first) {
+            this->eraseAt(first.idex_);
+            ++erased;
+        }
+        this->shrinkIfSparse();
+        return erased;
+    }
+
+    /**
+     * @brief Erase every key-value pair that satisfies a predicate, in one sweep
+     * over the table. Elements are not moved during the sweep, and the HashMap
+     * shrinks at most once, at the end, and only with a shrink load factor.
+     *
+     * @param pred Called as pred(const value_type &) for every element.
+     * @return Number of key-value pairs erased.
+     */
+    template <typename Pred>
+    size_t erase_if(Pred &&pred) {
+        size_t erased = 0;
+        for (auto it = this->cbegin(); it != this->cend(); ++it) {
+            if (pred(*it)) {
+                this->eraseAt(it.idex_);
+                ++erased;
+            }
+        }
+        this->shrinkIfSparse();
+        return erased;
+    }
+
+    /**
+     * @brief Erase the key-value pair of a key. Returns whether the
+     * key-value pair was successfully removed.
+     * 
+     * @param key Key to erase.
+     * @return Whether the key-value pair was found and removed. 
+     */
+    template <typename L = K>
+    bool erase(const KeyArg<L> &key) {
+        return this->erase(this->template find<L>(key));
+    }
+
+    /**
+     * @brief Take the element at an iterator out of the HashMap, without copying
+     * or destroying it. Does not shrink the HashMap, so other iterators stay valid.
+     *
+     * @param pos Iterator to the element to extract.
+     * @return Node owning the element, or an empty node if pos is end().
+     */
+    node_type extract(const_iterator pos) {
+        if (pos == this->cend()) {
+            return node_type();
+        }
+        size_t idex = pos.idex_;
+        if (idex > this->capacity_) {
+            // Still in the table being migrated from
+            idex = this->migrateSlot(idex - this->capacity_ - 1);
+        }
+        return this->extractAt(idex, this->hashAt(idex));
+    }
+
+    /**
+     * @brief Take the element of a key out of the HashMap. See extract(pos).
+     *
+     * @param key Key to extract.
+     * @return Node owning the element, or an empty node if the key is not present.
+     */
+    template <typename L = K>
+    node_type extract(const KeyArg<L> &key) {
+        size_t hash = this->hashKey(key);
+        if (auto idex = this->findAndMigrate(key, hash)) {
+            return this->extractAt(*idex, hash);
+        }
+        return node_type();
+    }
+
+    /**
+     * @brief Insert the element of a node from extract(), moving it into a slot.
+     * The key is not rehashed if the node came from a HashMap whose hasher hashes
+     * alike. The node's allocator must equal the HashMap's.
+     *
+     * @param node Node to insert. Emptied if inserted, and left untouched if the
+     * key already has a value.
+     * @return Iterator to the inserted element, or std::nullopt if the node is
+     * empty or the key already has a value.
+     */
+    std::optional<iterator> insert(node_type &&node) {
+        if (node.empty()) {
+            return std::nullopt;
+        }
+        assert(*node.alloc_ == this->table_.get_allocator());
+        size_t hash =
+            this->hashesAlike(node.hashSeed_) ? node.hash_ : this->hashKey(node.key());
+        auto loc = this->findOrPrepareInsert(node.key(), hash);
+        if (!loc.free) {
+            return std::nullopt;
+        }
+        this->transferSlot(&this->slots()[loc.idex], node.stored());
+        node.alloc_.reset();
+        this->commitInsertion(loc);
+        return this->iteratorAt(loc.idex);
+    }
+
+    /**
+     * @brief Move every element of source whose key is absent from this HashMap
+     * into it, slot to slot. Elements whose key is already present stay in
+     * source. Grows at most once, to fit both HashMaps.
+     *
+     * Keys are not rehashed when the hashers hash alike and the policy stores
+     * hashes. An empty HashMap whose hasher hashes alike and whose allocator
+     * equals source's takes over the table of source instead.
+     *
+     * @param source HashMap to move elements out of.
+     * @return Number of elements moved.
+     */
+    size_t merge(HashMap &source) {
+        if (&source == this || source.empty()) {
+            return 0;
+        }
+        bool sameHashes = this->hashesAlike(detail::HashSeedOf(source.hashRef()));
+        if (this->empty() && sameHashes && this->get_allocator() == source.get_allocator()) {
+            // Keep our own tuning, which assignFrom() replaces
+            size_t merged = source.size_;
+            Tuning tuning = this->tuning_;
+            this->assignFrom(std::move(source));
+            this->tuning_ = tuning;
+            this->updateLimits();
+            if (this->size_ > this->growthLimit_) {
+                // The adopted table is fuller than our max load factor allows
+                this->growAndRehash(this->capacityFor(this->size_));
+            }
+            return merged;
+        }
+
+        source.finishMigration();
+        this->reserve(this->size_ + source.size_);
+        size_t merged = 0;
+        for (size_t i = 0; i < source.capacity_; ++i) {
+            if (detail::IsFree(source.metadata()[i])) {
+                continue;
+            }
+            const K &key = keyOf(source.element(i));
+            size_t hash = sameHashes ? source.hashAt(i) : this->hashKey(key);
+            auto loc = this->findOrPrepareInsert(key, hash);
+            if (!loc.free) {
+                continue;
+            }
+            this->transferSlot(&this->slots()[loc.idex], &source.slots()[i]);
+            this->commitInsertion(loc);
+            source.releaseSlot(i);
+            --source.size_;
+            ++merged;
+        }
+        return merged;
+    }
+
+    size_t merge(HashMap &&source) {
+        return this->merge(source);
+    }
+
+    /**
+     * @brief Clear all elements from the HashMap. Keeps the table for reuse,
+     * unless the HashMap shrinks automatically, in which case tables larger
+     * than DefaultInitialCapacity are freed.
+     */
+    void clear() {
+        if (this->empty()) {
+            return;
+        }
+        this->destroySlots();
+        if (this->tuning_.shrinkLoadFactor != 0 && this->capacity_ > DefaultInitialCapacity) {
+            this->capacity_ = normalizeCapacity(DefaultInitialCapacity);
+            this->table_ = makeTable(this->capacity_, this->get_allocator());
+        }
+        this->resetMetadata();
+        this->resetOldTable();
+        this->size_ = 0;
+        this->deletedCount_ = 0;
+    }
+
+    /**
+     * @brief Grow the HashMap so that it can hold at least n elements at its
+     * max load factor. Causes a rehash if growing is required.
+     * @param n Number of elements to reserve space for.
+     */
+    void reserve(size_t n) {
+        if (this->capacityToGrowth(this->capacity_) >= n) {
+            return;
+        }
+        this->growAndRehash(this->capacityFor(n));
+    }
+
+    /**
+     * @brief Reserve at least enough empty slots, rehashing on an executor if
+     * growing is required. Elements must be nothrow move constructible, or be
+     * stored in nodes, for the rehash to run in parallel.
+     *
+     * @param n Number of elements to reserve space for.
+     * @param executor Executor to run the rehash on, such as a ThreadExecutor.
+     */
+    template <typename Executor>
+    void reserve(size_t n, Executor &&executor) {
+        if (this->capacityToGrowth(this->capacity_) >= n) {
+            return;
+        }
+        this->growAndRehash(this->capacityFor(n), executor);
+    }
+
+    /**
+     * @brief Rehash the HashMap into a table of at least n slots that holds its
+     * elements at the max load factor, dropping every deleted slot. Unlike
+     * reserve(), this shrinks the HashMap if n is small.
+     *
+     * @param n Fewest slots of the new table. 0 fits the table to its elements.
+     */
+    void rehash(size_t n) {
+        size_t newCapacity = normalizeCapacity(std::max(n, this->capacityFor(this->size_)));
+        if constexpr (Policy::IncrementalResize) {
+            this->finishMigration();
+        }
+        if (newCapacity != this->capacity_) {
+            this->resize(newCapacity);
+        } else if (this->deletedCount_ != 0) {
+            this->rehashEverything();
+        }
+    }
+
+    /**
+     * @brief Shrink the HashMap to the smallest table that holds its elements
+     * at the max load factor, returning the rest of its memory to the allocator.
+     * An empty HashMap frees its table until the next insertion.
+     */
+    void shrink_to_fit() {
+        this->rehash(0);
+    }
+
+    /**
+     * @brief Get the number of elements in the HashMap
+     */
+    size_t size() const {
+        return this->size_;
+    }
+
+    /**
+     * @brief Get the slot capacity of the HashMap.
+     */
+    size_t capacity() const {
+        return this->capacity_;
+    }
+
+    /**
+     * @brief Get the fraction of slots holding elements.
+     */
+    float load_factor() const {
+        return this->capacity_ == 0 ? 0 : static_cast<float>(this->size_) / this->capacity_;
+    }
+
+    /**
+     * @brief Get the fraction of slots that elements and deleted slots may fill
+     * before an insertion grows or rehashes the table.
+     */
+    float max_load_factor() const {
+        return this->tuning_.maxLoadFactor;
+    }
+
+    /**
+     * @brief Set the max load factor, overriding the policy's MaxLoadFactor.
+     * Grows the HashMap if its elements no longer fit. Throws
+     * std::invalid_argument unless 0 < loadFactor <= 1.
+     */
+    void max_load_factor(float loadFactor) {
+        if (!(loadFactor > 0 && loadFactor <= 1)) {
+            throw std::invalid_argument("max load factor must be in (0, 1]");
+        }
+        this->tuning_.maxLoadFactor = loadFactor;
+        this->updateLimits();
+        if (this->size_ > this->growthLimit_) {
+            this->growAndRehash(this->capacityFor(this->size_));
+        }
+    }
+
+    /**
+     * @brief Get the factor the capacity grows by when the HashMap fills.
+     */
+    float growth_factor() const {
+        return this->tuning_.growthFactor;
+    }
+
+    /**
+     * @brief Set the growth factor, overriding the policy's GrowthFactor.
+     * Throws std::invalid_argument unless growthFactor > 1.
+     */
+    void growth_factor(float growthFactor) {
+        if (!(growthFactor > 1)) {
+            throw std::invalid_argument("growth factor must be greater than 1");
+        }
+        this->tuning_.growthFactor = growthFactor;
+    }
+
+    /**
+     * @brief Get the fraction of deleted slots among the used slots of a full
+     * HashMap at which it rehashes in place instead of growing.
+     */
+    float min_deleted_rehash_fraction() const {
+        return this->tuning_.minDeletedRehashFraction;
+    }
+
+    /**
+     * @brief Set the deleted slot fraction, overriding the policy's
+     * MinDeletedRehashFraction. Throws std::invalid_argument unless 0 <= fraction <= 1.
+     */
+    void min_deleted_rehash_fraction(float fraction) {
+        if (!(fraction >= 0 && fraction <= 1)) {
+            throw std::invalid_argument("min deleted rehash fraction must be in [0, 1]");
+        }
+        this->tuning_.minDeletedRehashFraction = fraction;
+    }
+
+    /**
+     * @brief Get the fraction of slots holding elements below which erasures
+     * shrink the HashMap, or 0 if it never shrinks on its own.
+     */
+    float shrink_load_factor() const {
+        return this->tuning_.shrinkLoadFactor;
+    }
+
+    /**
+     * @brief Set the shrink load factor, overriding the policy's
+     * ShrinkLoadFactor. Throws std::invalid_argument unless
+     * 0 <= loadFactor <= 1. Factors above a quarter of the max load factor
+     * act as a quarter of it.
+     */
+    void shrink_load_factor(float loadFactor) {
+        if (!(loadFactor >= 0 && loadFactor <= 1)) {
+            throw std::invalid_argument("shrink load factor must be in [0, 1]");
+        }
+        this->tuning_.shrinkLoadFactor = loadFactor;
+        this->updateLimits();
+    }
+
+    /**
+     * @brief Check whether the HashMap is empty.
+     */
+    bool empty() const {
+        return this->size_ == 0;
+    }
+
+    /**
+     * @brief Get an iterator to the first element, or end() if the HashMap is
+     * empty. Elements are visited in no particular order.
+     */
+    iterator begin() {
+        return this->iteratorAt(this->firstFull());
+    }
+
+    /**
+     * @brief Get an iterator to the first element, or end() if the HashMap is
+     * empty. Elements are visited in no particular order.
+     */
+    const_iterator begin() const {
+        return this->iteratorAt(this->firstFull());
+    }
+
+    const_iterator cbegin() const {
+        return this->begin();
+    }
+
+    /**
+     * @brief Get an "end" iterator. "end" points to an invalid element and is
+     * returned from HashMap operations as a sentinel value.
+     */
+    inline iterator end() {
+        return iteratorAt(this->capacity_);
+    }
+
+    /**
+     * @brief Get an "end" iterator. "end" points to an invalid element and is
+     * returned from HashMap operations as a sentinel value.
+     */
+    inline const_iterator end() const {
+        return iteratorAt(this->capacity_);
+    }
+
+    const_iterator cend() const {
+        return this->end();
+    }
+
+    /**
+     * @brief Write the table to a snapshot file that map_readonly() can map
+     * back into memory as is. Requires trivially copyable keys and values
+     * stored inline. Throws std::runtime_error if the file cannot be written.
+     *
+     * @param path Path of the file to create or replace.
+     */
+    void save(const std::string &path) const {
+        static_assert(!Policy::NodeStorage, "Snapshots require inline storage");
+        static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                      "Snapshots require trivially copyable keys and values");
+        if (this->old_) {
+            // Copying finishes the migration
+            HashMap(*this).save(path);
+            return;
+        }
+
+        detail::SnapshotHeader header{};
+        std::copy_n(detail::SnapshotHeader::Magic, sizeof(header.magic), header.magic);
+        header.version = detail::SnapshotHeader::LayoutVersion;
+        header.flags = detail::SnapshotHeader::flagsOf<Policy>();
+        header.capacity = this->capacity_;
+        header.size = this->size_;
+        header.deletedCount = this->deletedCount_;
+        header.hashSeed = detail::HashSeedOf(this->hashRef());
+        header.groupWidth = detail::Group::Width;
+        header.slotSize = sizeof(Slot);
+        header.slotAlignment = alignof(Slot);
+        header.metadataBytes = this->table_.numBytes();
+        header.slotsOffset = snapshotSlotsOffset(header.metadataBytes);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(this->metadata()),
+                  static_cast<std::streamsize>(header.metadataBytes));
+        size_t padding = header.slotsOffset - sizeof(header) - header.metadataBytes;
+        std::fill_n(std::ostreambuf_iterator<char>(out), padding, '\0');
+
+        // Free slots are written as zeros rather than as uninitialized memory
+        constexpr size_t ChunkSlots = 1024;
+        std::vector<char> chunk(ChunkSlots * sizeof(Slot));
+        for (size_t begin = 0; begin < this->capacity_; begin += ChunkSlots) {
+            size_t count = std::min(ChunkSlots, this->capacity_ - begin);
+            std::fill(chunk.begin(), chunk.end(), '\0');
+            for (size_t i = 0; i < count; ++i) {
+                if (!detail::IsFree(this->metadata()[begin + i])) {
+                    std::memcpy(chunk.data() + i * sizeof(Slot),
+                                static_cast<const void*>(&this->slots()[begin + i]),
+                                sizeof(Slot));
+                }
+            }
+            out.write(chunk.data(), static_cast<std::streamsize>(count * sizeof(Slot)));
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("failed to write HashMap snapshot to " + path);
+        }
+    }
+
+    /**
+     * @brief Map a snapshot written by save() into memory, read-only, without
+     * deserializing it. Defined in MappedHashMap.hpp.
+     *
+     * @param path Path of the snapshot file.
+     * @param hash Hash function the snapshot was built with.
+     * @param eq Key equality function.
+     */
+    static MappedHashMap<K, V, Hash, Eq, Policy>
+    map_readonly(const std::string &path, const Hash &hash = Hash(), const Eq &eq = Eq());
+
+    /**
+     * @brief Write every element to a sink, in the order of the slots, through
+     * a bounded buffer.
+     *
+     * @tparam KeyCodec Codec for keys.
+     * @tparam ValueCodec Codec for values.
+     * @param sink Sink to write to, such as a StreamSink.
+     */
+    template <typename KeyCodec = Codec<K>, typename ValueCodec = Codec<V>, typename Sink>
+    void serialize(Sink &sink) const {
+        detail::BufferedWriter<Sink> out(sink);
+        out.write(detail::SerializedHeader::Magic, sizeof(detail::SerializedHeader::Magic));
+        Codec<uint32_t>::encode(out, detail::SerializedHeader::FormatVersion);
+        Codec<uint64_t>::encode(out, this->size_);
+        for (const auto &[key, value] : *this) {
+            KeyCodec::encode(out, key);
+            ValueCodec::encode(out, value);
+        }
+        out.flush();
+    }
+
+    /**
+     * @brief Replace the elements with those read from a source written by
+     * serialize(). The table is sized for every element before any is read,
+     * in steps past the first 64Ki elements, and nothing past the last element
+     * is read from the source. Throws
+     * std::runtime_error on malformed input, leaving the elements read so far.
+     *
+     * @tparam KeyCodec Codec for keys.
+     * @tparam ValueCodec Codec for values.
+     * @param source Source to read from, such as a StreamSource.
+     */
+    template <typename KeyCodec = Codec<K>, typename ValueCodec = Codec<V>, typename Source>
+    void deserialize(Source &source) {
+        detail::SourceReader<Source> in(source);
+        char magic[sizeof(detail::SerializedHeader::Magic)];
+        in.read(magic, sizeof(magic));
+        if (std::memcmp(magic, detail::SerializedHeader::Magic, sizeof(magic)) != 0 ||
+            Codec<uint32_t>::decode(in) != detail::SerializedHeader::FormatVersion) {
+            throw std::runtime_error("not a serialized HashMap");
+        }
+        auto count = static_cast<size_t>(Codec<uint64_t>::decode(in));
+
+        this->clear();
+        // Reserve for the count in steps that at most double what has been
+        // read, so that a corrupt count fails at the end of the input instead
+        // of allocating for it. Insertions check the load factor with the
+        // element they add.
+        size_t reserved = std::min(count, detail::DeserializeReserveLimit);
+        this->reserve(reserved);
+        for (size_t i = 0; i < count; ++i) {
+            if (i == reserved) {
+                reserved = count - reserved > reserved ? 2 * reserved : count;
+                this->reserve(reserved);
+            }
+            K key = KeyCodec::decode(in);
+            V value = ValueCodec::decode(in);
+            this->insert({std::move(key), std::move(value)});
+        }
+    }
+
+private:
+    template <typename, typename, typename, typename, typename>
+    friend class MappedHashMap;
+    template <typename, typename, typename, typename, typename>
+    friend class HashSet;
+
+    /**
+     * @brief Offset of the slot array in a snapshot file, aligned enough for a
+     * mapping of the file.
+     */
+    static constexpr size_t snapshotSlotsOffset(size_t metadataBytes) {
+        return detail::AlignUp(sizeof(detail::SnapshotHeader) + metadataBytes,
+                               std::max(alignof(Slot), detail::CacheLineSize));
+    }
+
+    using ProbeSeq = detail::ProbeSeq<Policy::PowerOfTwoCapacity>;
+
+    static const K &keyOf(const Slot &slot) {
+        return detail::SlotTraits<K, V>::key(slot);
+    }
+
+    using HasherHolder = detail::FunctorHolder<Hash, 0>;
+    using EqHolder = detail::FunctorHolder<Eq, 1>;
+
+    Hash &hashRef() {
+        return this->HasherHolder::get();
+    }
+
+    const Hash &hashRef() const {
+        return this->HasherHolder::get();
+    }
+
+    Eq &eqRef() {
+        return this->EqHolder::get();
+    }
+
+    const Eq &eqRef() const {
+        return this->EqHolder::get();
+    }
+
+    /**
+     * @brief Turn a hash_function() result into the hash the table probes with.
+     * Hashes are mixed unless the hasher declares them avalanching, so that
+     * their low bits are as good as their high bits. Stored hashes and every
+     * hash passed between the private members are mixed.
+     */
+    static size_t mixHash(size_t hash) {
+        return detail::MixHash<Hash>(hash);
+    }
+
+    template <typename L>
+    size_t hashKey(const L &key) const {
+        return mixHash(this->hashRef()(key));
+    }
+
+    /**
+     * @brief Allocate the storage for a table of a capacity. The metadata and
+     * the sentinel and cloned bytes are left uninitialized.
+     */
+    static Table makeTable(size_t capacity, const Allocator &alloc) {
+        size_t metadataSize = hashesOffset(capacity);
+        if constexpr (Policy::StoreHash) {
+            metadataSize += capacity * sizeof(size_t);
+        }
+        size_t alignment = Policy::TableAlignment;
+        if constexpr (Policy::HugePageThreshold != 0) {
+            if (metadataSize + capacity * sizeof(Slot) >= Policy::HugePageThreshold) {
+                alignment = detail::HugePageSize;
+            }
+        }
+        return Table(metadataSize, capacity, alignment, SlotAlloc(alloc));
+    }
+
+    /**
+     * @brief Offset of the stored hashes from the start of the metadata.
+     */
+    static constexpr size_t hashesOffset(size_t capacity) {
+        return detail::AlignUp(detail::MetadataSize(capacity), alignof(size_t));
+    }
+
+    detail::metadata_t* metadata() {
+        return this->table_.bytes();
+    }
+
+    const detail::metadata_t* metadata() const {
+        return this->table_.bytes();
+    }
+
+    StoredSlot* slots() {
+        return this->table_.data();
+    }
+
+    const StoredSlot* slots() const {
+        return this->table_.data();
+    }
+
+    Slot &element(size_t idex) {
+        return Storage::element(this->slots()[idex]);
+    }
+
+    const Slot &element(size_t idex) const {
+        return Storage::element(this->slots()[idex]);
+    }
+
+    /**
+     * @brief Get the hash of the element at an index, from the stored hashes if
+     * the policy keeps them.
+     */
+    size_t hashAt(size_t idex) const {
+        if constexpr (Policy::StoreHash) {
+            return this->hashes()[idex];
+        } else {
+            return this->hashKey(keyOf(this->element(idex)));
+        }
+    }
+
+    /**
+     * @brief Record the hash of the element at an index, if the policy keeps hashes.
+     */
+    void storeHash(size_t idex, size_t hash) {
+        if constexpr (Policy::StoreHash) {
+            this->hashes()[idex] = hash;
+        }
+    }
+
+    size_t* hashes() {
+        return reinterpret_cast<size_t*>(this->metadata() + hashesOffset(this->capacity_));
+    }
+
+    const size_t* hashes() const {
+        return reinterpret_cast<const size_t*>(this->metadata() + hashesOffset(this->capacity_));
+    }
+
+    struct InsertionLoc {
+        // The internal HashMap index
+        size_t idex;
+        // The hash of the key
+        size_t hash;
+        // Whether the slot is free for insertion, or already holds the key
+        bool free;
+    };
+
+    /**
+     * @brief Compute the internal location for inserting a key.
+     * 
+     * @param key Key for insertion.
+     * @param hash Hash of the key.
+     * @return The insertion location, or the location of the key if it already exists.
+     */
+    template <typename L>
+    InsertionLoc locationForInsertion(const L &key, size_t hash) const {
+        const Eq &eq = this->eqRef();
+        auto h2 = detail::H2(hash);
+
+        // The first free slot on the probe sequence. The key may still exist
+        // further along, so keep probing until an empty slot is seen.
+        std::optional<size_t> freeIdex;
+        ProbeSeq seq(detail::H1(hash), this->capacity_);
+        while (true) {
+            detail::Group group(this->metadata() + seq.offset());
+            for (uint32_t i : group.match(h2)) {
+                size_t idex = seq.offset(i);
+                if (eq(key, keyOf(this->element(idex)))) {
+                    // Key already exists
+                    return InsertionLoc{idex, hash, false};
+                }
+            }
+            if (!freeIdex) {
+                if (auto free = group.matchEmptyOrDeleted()) {
+                    freeIdex = seq.offset(free.lowestBitSet());
+                }
+            }
+            if (group.matchEmpty()) {
+                // Found free spot for insertion
+                return InsertionLoc{*freeIdex, hash, true};
+            }
+            seq.next();
+        }
+    }
+
+    /**
+     * @brief Find a key, or a free slot to insert it into with a single probe.
+     * Grows the table first if an insertion would exceed the load factor. The
+     * caller must construct the slot and call commitInsertion() if it is free.
+     *
+     * @param key Key to look up.
+     * @param hash Hash of the key.
+     * @return The location of the key, or a free location for it.
+     */
+    template <typename L>
+    InsertionLoc findOrPrepareInsert(const L &key, size_t hash) {
+        if constexpr (Policy::IncrementalResize) {
+            this->migrateStep();
+            if (auto oldIdex = this->doFindOld(key, hash)) {
+                // Key is still in the table being migrated from, move it over
+                return InsertionLoc{this->migrateSlot(*oldIdex), 0, false};
+            }
+        }
+
+        if (!this->empty()) {
+            auto loc = this->locationForInsertion(key, hash);
+            // Reusing a deleted slot leaves growthLeft() unchanged
+            if (!loc.free || this->growthLeft() != 0 ||
+                this->metadata()[loc.idex] == detail::Metadata::Deleted) {
+                return loc;
+            }
+        }
+        if (this->growthLeft() == 0) {
+            this->growOrRehash();
+        }
+        // The key is known to be absent, so only a free slot is needed
+        ProbeSeq seq(detail::H1(hash), this->capacity_);
+        return InsertionLoc{this->findFirstNonFull(seq), hash, true};
+    }
+
+    template <typename L>
+    InsertionLoc findOrPrepareInsert(const L &key) {
+        return this->findOrPrepareInsert(key, this->hashKey(key));
+    }
+
+    /**
+     * @brief Construct a slot at a free insertion location and commit the insertion.
+     *
+     * @param loc Free location from findOrPrepareInsert().
+     * @param args Arguments to construct the slot from.
+     * @return Iterator to the inserted slot.
+     */
+    template <typename... Args>
+    iterator constructAt(const InsertionLoc &loc, Args &&...args) {
+        assert(loc.free);
+        // Construct new slot entry in place
+        this->constructElement(&this->slots()[loc.idex], std::forward<Args>(args)...);
+        this->commitInsertion(loc);
+        return this->iteratorAt(loc.idex);
+    }
+
+    /**
+     * @brief Insert a key-value pair given the mixed hash of its key.
+     */
+    std::optional<iterator> insertMixed(std::pair<K, V> &&value, size_t hash) {
+        auto loc = this->findOrPrepareInsert(value.first, hash);
+        if (!loc.free) {
+            return std::nullopt;
+        }
+        // Construct new slot entry in place, moving the values.
+        return this->constructAt(loc, std::move(value.first), std::move(value.second));
+    }
+
+    /**
+     * @brief Mark a constructed slot as full and count it.
+     */
+    void commitInsertion(const InsertionLoc &loc) {
+        // Update the metadata with the hash data
+        this->markFull(loc);
+        // Increment size
+        ++this->size_;
+    }
+
+    template <typename KArg, typename... Args>
+    std::pair<iterator, bool> tryEmplaceImpl(KArg &&key, Args &&...args) {
+        auto loc = this->findOrPrepareInsert(key);
+        if (!loc.free) {
+            return {this->iteratorAt(loc.idex), false};
+        }
+        auto it = this->constructAt(loc,
+                                    std::piecewise_construct,
+                                    std::forward_as_tuple(std::forward<KArg>(key)),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+        return {it, true};
+    }
+
+    template <typename KArg, typename M>
+    std::pair<iterator, bool> insertOrAssignImpl(KArg &&key, M &&obj) {
+        auto loc = this->findOrPrepareInsert(key);
+        if (!loc.free) {
+            this->element(loc.idex).second = std::forward<M>(obj);
+            return {this->iteratorAt(loc.idex), false};
+        }
+        return {this->constructAt(loc, std::forward<KArg>(key), std::forward<M>(obj)), true};
+    }
+
+    /**
+     * @brief Emplace a key and value given separately, looking up the key first.
+     */
+    template <typename KArg,
+              typename VArg,
+              typename = std::enable_if_t<std::is_same_v<std::decay_t<KArg>, K>>>
+    std::pair<iterator, bool> emplaceImpl(KArg &&key, VArg &&value) {
+        return this->tryEmplaceImpl(std::forward<KArg>(key), std::forward<VArg>(value));
+    }
+
+    /**
+     * @brief Emplace a key-value pair, looking up its key first.
+     */
+    template <typename P,
+              typename = std::enable_if_t<
+                  std::is_same_v<std::decay_t<decltype(std::declval<P>().first)>, K>>>
+    std::pair<iterator, bool> emplaceImpl(P &&pair) {
+        return this->tryEmplaceImpl(std::forward<P>(pair).first, std::forward<P>(pair).second);
+    }
+
+    /**
+     * @brief Emplace from arbitrary arguments. The key is unknown until the
+     * element is constructed, so build it first and move it in if absent.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplaceImpl(Args &&...args) {
+        Slot tmp(std::forward<Args>(args)...);
+        auto loc = this->findOrPrepareInsert(tmp.first);
+        if (!loc.free) {
+            return {this->iteratorAt(loc.idex), false};
+        }
+        return {this->constructAt(loc, std::move(tmp)), true};
+    }
+
+    /**
+     * @brief Move the element at an index into a node and free its slot.
+     *
+     * @param idex Index of the element.
+     * @param hash Mixed hash of its key.
+     */
+    node_type extractAt(size_t idex, size_t hash) {
+        node_type node;
+        node.alloc_.emplace(this->table_.get_allocator());
+        this->transferSlot(node.stored(), &this->slots()[idex]);
+        node.hash_ = hash;
+        node.hashSeed_ = detail::HashSeedOf(this->hashRef());
+        this->releaseSlot(idex);
+        --this->size_;
+        return node;
+    }
+
+    /**
+     * @brief Check whether hashes computed by a hasher with a seed are valid for
+     * this HashMap. See detail::SeedIdentifiesHash.
+     */
+    bool hashesAlike(uint64_t hashSeed) const {
+        return detail::SeedIdentifiesHash<Hash> && hashSeed == detail::HashSeedOf(this->hashRef());
+    }
+
+    /**
+     * @brief Destroy the slot at an index. Update the metadata and call the slot destructor.
+     * 
+     * @param idex Index to destroy at.
+     */
+    void destroySlot(size_t idex) {
+        this->releaseSlot(idex);
+        // Call destructor on slot entry
+        this->destroyElement(&this->slots()[idex]);
+    }
+
+    /**
+     * @brief Mark the slot at an index free, leaving its element to the caller
+     * to destroy or move out. Does not update the size.
+     *
+     * @param idex Index to free.
+     */
+    void releaseSlot(size_t idex) {
+        if (this->wasNeverFull(idex)) {
+            // No probe ever passed over the slot, so it can be empty again
+            this->setMetadata(idex, detail::Metadata::Empty);
+        } else {
+            // Mark slot as deleted
+            this->setMetadata(idex, detail::Metadata::Deleted);
+            ++this->deletedCount_;
+        }
+    }
+
+    /**
+     * @brief Check whether every group that covers a full slot has an empty
+     * slot. Probes stop at the first group with an empty slot, so none has
+     * ever continued past such a slot, and erasing it needs no tombstone.
+     */
+    bool wasNeverFull(size_t idex) const {
+        constexpr size_t Width = detail::Group::Width;
+        if (this->capacity_ < Width) {
+            // Groups of small tables do not wrap around the control ring
+            return false;
+        }
+        size_t before = idex >= Width ? idex - Width : idex + this->capacity_ + 1 - Width;
+        auto emptyAfter = detail::Group(this->metadata() + idex).matchEmpty();
+        auto emptyBefore = detail::Group(this->metadata() + before).matchEmpty();
+        // Count the run of non-empty slots through idex, which must not fill a group
+        return emptyBefore && emptyAfter &&
+               emptyAfter.lowestBitSet() + emptyBefore.leadingZeros() < Width;
+    }
+
+    /**
+     * @brief Erase the element at an iterator position, without shrinking or
+     * migrating. Deleted slots count against growthLeft(), so the next
+     * insertion into a full table drops them.
+     */
+    void eraseAt(size_t idex) {
+        if (idex > this->capacity_) {
+            // Iteration reached an element still in the table being migrated from
+            this->eraseOld(idex - this->capacity_ - 1);
+        } else {
+            this->destroySlot(idex);
+        }
+        --this->size_;
+    }
+
+    /**
+     * @brief Shrink the table if erasures left it below the shrink load factor.
+     *
+     * @return Whether the table shrank.
+     */
+    bool shrinkIfSparse() {
+        if (this->size_ >= this->shrinkLimit_) {
+            return false;
+        }
+        // Land at half the max load factor
+        size_t newCapacity = normalizeCapacity(
+            std::max(DefaultInitialCapacity, this->capacityFor(2 * this->size_)));
+        if (newCapacity >= this->capacity_) {
+            // Already the table the shrink would land at, so a rehash buys nothing
+            return false;
+        }
+        this->rehash(newCapacity);
+        return true;
+    }
+
+    /**
+     * @brief Call the destructor of every full slot. Does not update the metadata.
+     */
+    void destroySlots() {
+        if (Storage::TriviallyDestructible || this->empty()) {
+            return;
+        }
+        for (size_t i = 0; i < this->capacity_; ++i) {
+            if (!detail::IsFree(this->metadata()[i])) {
+                this->destroyElement(&this->slots()[i]); // Destroy slot entry
+            }
+        }
+    }
+
+    /**
+     * @brief Construct an element in a slot through the allocator.
+     */
+    template <typename... Args>
+    void constructElement(StoredSlot* slot, Args &&...args) {
+        SlotAlloc alloc = this->table_.get_allocator();
+        Storage::construct(alloc, slot, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Destroy the element in a slot through the allocator.
+     */
+    void destroyElement(StoredSlot* slot) {
+        SlotAlloc alloc = this->table_.get_allocator();
+        Storage::destroy(alloc, slot);
+    }
+
+    /**
+     * @brief Set the metadata of a slot, keeping its cloned byte in sync.
+     */
+    void setMetadata(size_t idex, detail::metadata_t metadata) {
+        detail::SetMetadata(this->metadata(), this->capacity_, idex, metadata);
+    }
+
+    /**
+     * @brief Mark the slot at an insertion location as full.
+     */
+    void markFull(const InsertionLoc &loc) {
+        if (this->metadata()[loc.idex] == detail::Metadata::Deleted) {
+            // Reusing a deleted slot
+            --this->deletedCount_;
+        }
+        this->setMetadata(loc.idex, detail::H2(loc.hash));
+        this->storeHash(loc.idex, loc.hash);
+    }
+
+    /**
+     * @brief Mark every slot as empty and lay out the sentinel and cloned bytes.
+     */
+    void resetMetadata() {
+        std::fill_n(
+            this->metadata(), detail::MetadataSize(this->capacity_), detail::Metadata::Empty);
+        this->metadata()[this->capacity_] = detail::Metadata::Sentinel;
+        // Cloned bytes that wrap past a small table only ever hold the sentinel
+        for (size_t i = this->capacity_; i < detail::NumClonedBytes; ++i) {
+            this->metadata()[this->capacity_ + 1 + i] = detail::Metadata::Sentinel;
+        }
+        this->updateLimits();
+    }
+
+    /**
+     * @brief Get the address of the element at an iterator position. Positions
+     * past end() address the table being migrated from.
+     */
+    Slot* slotAddress(size_t idex) {
+        if (idex > this->capacity_) {
+            return &this->old_->element(idex - this->capacity_ - 1);
+        }
+        return Storage::address(this->slots(), idex, this->capacity_);
+    }
+
+    const Slot* slotAddress(size_t idex) const {
+        return const_cast<HashMap*>(this)->slotAddress(idex);
+    }
+
+    /**
+     * @brief Get the iterator position of the first element, or end().
+     */
+    size_t firstFull() const {
+        if (this->empty()) {
+            return this->capacity_;
+        }
+        if (this->old_) {
+            // Visit the elements still in the old table first
+            return this->nextFull(this->capacity_ + 1 + this->old_->cursor);
+        }
+        return this->nextFull(0);
+    }
+
+    /**
+     * @brief Get the first full iterator position at or after a position, or
+     * end(). Positions past end() are in the table being migrated from, which
+     * continues into the current table.
+     */
+    size_t nextFull(size_t idex) const {
+        if (idex > this->capacity_) {
+            size_t oldIdex = nextFullIn(
+                this->old_->metadata(), this->old_->capacity, idex - this->capacity_ - 1);
+            if (oldIdex < this->old_->capacity) {
+                return this->capacity_ + 1 + oldIdex;
+            }
+            idex = 0;
+        }
+        return nextFullIn(this->metadata(), this->capacity_, idex);
+    }
+
+    /**
+     * @brief Find the first full slot at or after an index, skipping a group of
+     * free slots at a time.
+     *
+     * @return Index of the full slot, or capacity if there is none.
+     */
+    static size_t nextFullIn(const detail::metadata_t* metadata, size_t capacity, size_t idex) {
+        if (idex < capacity && !detail::IsFree(metadata[idex])) {
+            // Dense tables mostly continue with a full slot
+            return idex;
+        }
+        while (idex < capacity) {
+            detail::Group group(metadata + idex);
+            if (auto full = group.matchFull()) {
+                // The sentinel is never full, so a match past it means there is none
+                return std::min(idex + full.lowestBitSet(), capacity);
+            }
+            idex += detail::Group::Width;
+        }
+        return capacity;
+    }
+
+    /**
+     * @brief Get an iterator to an internal HashTable index.
+     */
+    inline iterator iteratorAt(size_t idex) {
+        return iterator(idex, this->slotAddress(idex), this);
+    }
+
+    /**
+     * @brief Get an iterator to an internal HashTable index.
+     */
+    inline const_iterator iteratorAt(size_t idex) const {
+        return const_iterator(idex, this->slotAddress(idex), this);
+    }
+
+    /**
+     * @brief Get a mutable iterator to the element of a const_iterator.
+     */
+    iterator mutableIterator(const_iterator it) {
+        return this->iteratorAt(it.idex_);
+    }
+
+    /**
+     * @brief Get an iterator to an internal HashTable index. Returns iterator to end
+     * if value is not set.
+     */
+    inline iterator iteratorAt(std::optional<size_t> maybeIdex) {
+        if (maybeIdex) {
+            return iteratorAt(*maybeIdex);
+        }
+        return this->end();
+    }
+
+    /**
+     * @brief Get an iterator to an internal HashTable index. Returns iterator to end
+     * if value is not set.
+     */
+    inline const_iterator iteratorAt(std::optional<size_t> maybeIdex) const {
+        if (maybeIdex) {
+            return iteratorAt(*maybeIdex);
+        }
+        return this->end();
+    }
+
+    /**
+     * @brief Find a key in the HashTable.
+     * 
+     * @param key Key to find.
+     * @param hash Hash of the key.
+     * @return Internal HashTable index of key-value, or std::nullopt if not found.
+     */
+    template <typename L>
+    std::optional<size_t> doFind(const L &key, size_t hash) const {
+        if (this->empty()) {
+            this->recordLookup(false, 0);
+            return std::nullopt;
+        }
+        if constexpr (Policy::CollectStats) {
+            size_t groups = 0;
+            auto res = findInTable(key,
+                                   hash,
+                                   this->metadata(),
+                                   this->slots(),
+                                   this->capacity_,
+                                   this->eqRef(),
+                                   &groups);
+            this->recordLookup(res.has_value(), groups);
+            return res;
+        } else {
+            return findInTable(
+                key, hash, this->metadata(), this->slots(), this->capacity_, this->eqRef());
+        }
+    }
+
+    /**
+     * @brief Find a key in the table being migrated from, if any.
+     * 
+     * @param key Key to find.
+     * @param hash Hash of the key.
+     * @return Index of key-value in the old table, or std::nullopt if not found.
+     */
+    template <typename L>
+    std::optional<size_t> doFindOld(const L &key, size_t hash) const {
+        if constexpr (Policy::IncrementalResize) {
+            if (this->old_ && this->old_->size != 0) {
+                return findInTable(key,
+                                   hash,
+                                   this->old_->metadata(),
+                                   this->old_->slots(),
+                                   this->old_->capacity,
+                                   this->eqRef());
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Find a key in a table given by its metadata and slots.
+     *
+     * @param groupsProbed If not null, set to the number of groups probed past
+     * the first.
+     * @return Index of key-value in the table, or std::nullopt if not found.
+     */
+    template <typename L>
+    static std::optional<size_t> findInTable(const L &key,
+                                             size_t hash,
+                                             const detail::metadata_t* metadata,
+                                             const StoredSlot* slots,
+                                             size_t capacity,
+                                             const Eq &eq,
+                                             size_t* groupsProbed = nullptr) {
+        auto h2 = detail::H2(hash);
+
+        ProbeSeq seq(detail::H1(hash), capacity);
+        while (true) {
+            detail::Group group(metadata + seq.offset());
+            for (uint32_t i : group.match(h2)) {
+                size_t idex = seq.offset(i);
+                if (eq(key, keyOf(Storage::element(slots[idex])))) {
+                    // Found key
+                    if (groupsProbed) {
+                        *groupsProbed = seq.index() / detail::Group::Width;
+                    }
+                    return idex;
+                }
+            }
+            if (group.matchEmpty()) {
+                // Found empty slot, must not be in hash table
+                if (groupsProbed) {
+                    *groupsProbed = seq.index() / detail::Group::Width;
+                }
+                return std::nullopt;
+            }
+            seq.next();
         }
-        // Perform the insert
-        return this->insertUnchecked(std::move(value));
     }
 
     /**
-     * @brief Get the value of a key in the HashMap. If the key is not present,
-     * a default-constructed value is first inserted.
-     * 
-     * @param key Key to look up.
-     * @return Reference to the value.
+     * @brief Find a key in the HashTable. A key still in the table being migrated
+     * from is moved into the current table first, so only mutating operations
+     * may use it.
+     *
+     * @param key Key to find.
+     * @return Internal HashTable index of key-value, or std::nullopt if not found.
      */
-    template <typename U = V>
-    typename std::enable_if_t<std::is_default_constructible_v<U>, V &> operator[](const K &key) {
-        auto res = this->doFind(key);
-        if (res) {
-            return this->slots_[res.value()].second;
+    template <typename L>
+    std::optional<size_t> findAndMigrate(const L &key, size_t hash) {
+        auto res = this->doFind(key, hash);
+        if constexpr (Policy::IncrementalResize) {
+            if (!res) {
+                if (auto oldIdex = this->doFindOld(key, hash)) {
+                    res = this->migrateSlot(*oldIdex);
+                }
+            }
         }
-        // Need to insert and then return
-        auto it = this->insert(std::make_pair<K, V>(K{key}, V{}));
-        assert(it.has_value());
-        return this->slots_[it->idex_].second;
+        return res;
     }
 
     /**
-     * @brief Erase the key-value pair at an iterator. Returns whether the
-     * key-value pair was successfully removed.
-     * 
-     * @param it Iterator to delete
-     * @return Whether the key-value pair was found and removed. 
+     * @brief Find a key in either table without migrating it, so that lookups
+     * never move elements under an iteration.
+     *
+     * @param key Key to find.
+     * @param hash Hash of the key.
+     * @return Iterator position of the element, or std::nullopt if not found.
      */
-    bool erase(iterator it) {
-        if (it == this->end()) {
-            return false;
+    template <typename L>
+    std::optional<size_t> findIndex(const L &key, size_t hash) const {
+        if (auto res = this->doFind(key, hash)) {
+            return res;
         }
-        assert(it.idex_ < this->capacity_);
-        // Delete data associated with key-value pair
-        this->destroySlot(it.idex_);
-        // Decrement size
-        --this->size_;
-
-        // Check if we have an elevated number of deleted slots.
-        // If so, we want to rehash everything to prevent fragmentation.
-        if (this->needRehash()) {
-            this->rehashEverything();
+        if (auto res = this->doFindOld(key, hash)) {
+            // Encoded past end() so that it cannot compare equal to a slot of the current table
+            return this->capacity_ + 1 + *res;
         }
-
-        return true;
+        return std::nullopt;
     }
 
     /**
-     * @brief Erase the key-value pair of a key. Returns whether the
-     * key-value pair was successfully removed.
-     * 
-     * @param key Key to erase.
-     * @return Whether the key-value pair was found and removed. 
+     * @brief Find a key in either table without migrating it.
+     *
+     * @param key Key to find.
+     * @param hash Hash of the key.
+     * @return Iterator to the element, or end() if not found.
      */
-    bool erase(const K &key) {
-        return this->erase(this->find(key));
+    template <typename L>
+    const_iterator findConst(const L &key, size_t hash) const {
+        return this->iteratorAt(this->findIndex(key, hash));
     }
 
-    /**
-     * @brief Clear all elements from the HashMap.
-     */
-    void clear() {
-        if (this->empty()) {
-            return;
-        }
-        for (size_t i = 0; i < this->capacity_; ++i) {
-            if (!detail::IsFree(this->metadata_[i])) {
-                this->slots_[i].~Slot(); // Destroy slot entry
-            }
-            this->metadata_[i] = detail::Metadata::Empty;
-        }
-        this->size_ = 0;
-        this->deletedCount_ = 0;
+    template <typename L>
+    bool containsHashed(const L &key, size_t hash) const {
+        return this->doFind(key, hash).has_value() || this->doFindOld(key, hash).has_value();
     }
 
     /**
-     * @brief Reserve at least enough empty slots. Does not consider the load factor.
-     * Causes a rehash if growing is required.
-     * @param n Number of slots to reserve.
+     * @brief Prefetch the first group of metadata and slots probed for a hash.
      */
-    void reserve(size_t n) {
-        auto target = static_cast<size_t>(n / MaxLoadFactor);
-        if (this->capacity_ >= target) {
-            return;
-        }
-        this->growAndRehash(target);
+    void prefetchHash(size_t hash) const {
+        size_t offset = ProbeSeq(detail::H1(hash), this->capacity_).offset();
+        detail::Prefetch(this->metadata() + offset);
+        detail::Prefetch(this->slots() + offset);
     }
 
     /**
-     * @brief Get the number of elements in the HashMap
+     * @brief Number of keys whose lookups are overlapped by the batch lookups.
+     * Bounded by the number of outstanding cache misses a core can track.
      */
-    size_t size() const {
-        return this->size_;
-    }
+    static constexpr size_t LookupBatchSize = 16;
 
     /**
-     * @brief Get the slot capacity of the HashMap.
+     * @brief Look up keys in batches of LookupBatchSize: hash and prefetch every
+     * key of a batch, then resolve each one.
+     *
+     * @param resolve Lookup of a key given its hash, whose result is written to out.
      */
-    size_t capacity() const {
-        return this->capacity_;
+    template <typename ForwardIt, typename OutputIt, typename Resolve>
+    OutputIt lookupBatch(ForwardIt first, ForwardIt last, OutputIt out, Resolve resolve) const {
+        using L = typename std::iterator_traits<ForwardIt>::value_type;
+        std::array<size_t, LookupBatchSize> hashes;
+        while (first != last) {
+            size_t n = 0;
+            for (ForwardIt it = first; it != last && n < LookupBatchSize; ++it, ++n) {
+                const KeyArg<L> &key = *it;
+                hashes[n] = this->hashKey(key);
+                this->prefetchHash(hashes[n]);
+            }
+            for (size_t i = 0; i < n; ++i, ++first) {
+                const KeyArg<L> &key = *first;
+                *out = resolve(key, hashes[i]);
+                ++out;
+            }
+        }
+        return out;
     }
 
     /**
-     * @brief Check whether the HashMap is empty.
+     * @brief Insert an element known not to be in the HashTable, without
+     * checking for capacity.
+     *
+     * @param hash Hash of the element's key.
+     * @param args Arguments to construct the slot from.
+     * @return Internal HashTable index of the new element.
      */
-    bool empty() const {
-        return this->size_ == 0;
+    template <typename... Args>
+    size_t insertNew(size_t hash, Args &&...args) {
+        size_t idex = this->claimNew(hash);
+        this->constructElement(&this->slots()[idex], std::forward<Args>(args)...);
+        return idex;
     }
 
     /**
-     * @brief Get an "end" iterator. "end" points to an invalid element and is
-     * returned from HashMap operations as a sentinel value.
+     * @brief Move an element known not to be in the HashTable out of another
+     * table's slot, without checking for capacity. The tables must share an
+     * allocator.
+     *
+     * @param hash Hash of the element's key.
+     * @param src Slot to take the element from. Left without an element.
+     * @return Internal HashTable index of the moved element.
      */
-    inline iterator end() {
-        return iteratorAt(this->slots_.size());
+    size_t transferNew(size_t hash, StoredSlot* src) {
+        size_t idex = this->claimNew(hash);
+        this->transferSlot(&this->slots()[idex], src);
+        return idex;
     }
 
     /**
-     * @brief Get an "end" iterator. "end" points to an invalid element and is
-     * returned from HashMap operations as a sentinel value.
+     * @brief Mark the first free slot on the probe sequence of a hash as full.
+     *
+     * @return Internal HashTable index of the slot.
      */
-    inline const_iterator end() const {
-        return iteratorAt(this->slots_.size());
+    size_t claimNew(size_t hash) {
+        ProbeSeq seq(detail::H1(hash), this->capacity_);
+        size_t idex = this->findFirstNonFull(seq);
+        this->markFull(InsertionLoc{idex, hash, true});
+        return idex;
     }
 
-private:
-    struct InsertionLoc {
-        // The internal HashMap index
-        size_t idex;
-        // The level 2 hash of the key (for metadata)
-        size_t h2;
-    };
-
     /**
-     * @brief Compute the internal location for inserting a key.
-     * 
-     * @param key Key for insertion.
-     * @return The insertion location, or std::nullopt if the key already exists.
+     * @brief The table being migrated from during an incremental resize. Slots
+     * before the cursor have already been migrated.
      */
-    std::optional<InsertionLoc> locationForInsertion(const K &key) const {
-        Hash hasher;
-        Eq eq;
-        size_t hash = hasher(key);
-        auto h1 = detail::H1(hash);
-        auto h2 = detail::H2(hash);
-
-        size_t idex = h1 % this->capacity_;
-        while (true) {
-            auto metadata = this->metadata_[idex];
-            if (detail::IsFree(metadata)) {
-                // Found free spot for insertion
-                return InsertionLoc{idex, h2};
-            } else if (metadata == h2 && eq(key, this->slots_[idex].first)) {
-                // Key already exists
-                return std::nullopt;
+    struct OldTable {
+        OldTable(size_t capacity, Table &&table, size_t size)
+            : capacity(capacity)
+            , size(size)
+            , table(std::move(table)) {}
+
+        ~OldTable() {
+            if (Storage::TriviallyDestructible || this->size == 0) {
+                return;
+            }
+            for (size_t i = this->cursor; i < this->capacity; ++i) {
+                if (!detail::IsFree(this->metadata()[i])) {
+                    SlotAlloc alloc = this->table.get_allocator();
+                    Storage::destroy(alloc, &this->slots()[i]); // Destroy slot entry
+                }
             }
-            idex = (idex + 1) % this->capacity_;
         }
-    }
 
-    /**
-     * @brief Insert a key-value pair without checking for capacity.
-     * 
-     * @param value Key-value pair to insert.
-     * @return Iterator to the inserted key-value pair, or std::nullopt if key already exists.
-     */
-    std::optional<iterator> insertUnchecked(const std::pair<K, V> &value) {
-        if (auto loc = this->locationForInsertion(value.first)) {
-            // Insert value into slot. Update the metadata with the hash data.
-            this->metadata_[loc->idex] = loc->h2;
-            // Construct new slot entry in place
-            new (&this->slots_[loc->idex]) Slot{value.first, value.second};
-            // Increment size
-            ++this->size_;
-            return this->iteratorAt(loc->idex);
+        OldTable(const OldTable &other) = delete;
+        OldTable &operator=(const OldTable &other) = delete;
+
+        detail::metadata_t* metadata() {
+            return this->table.bytes();
         }
-        return std::nullopt;
-    }
 
-    /**
-     * @brief Insert a key-value pair without checking for capacity.
-     * 
-     * @param value Key-value pair to insert.
-     * @return Iterator to the inserted key-value pair, or std::nullopt if key already exists.
-     */
-    std::optional<iterator> insertUnchecked(std::pair<K, V> &&value) {
-        if (auto loc = this->locationForInsertion(value.first)) {
-            // Insert value into slot. Update the metadata with the hash data.
-            this->metadata_[loc->idex] = loc->h2;
-            // Construct new slot entry in place, moving the values.
-            new (&this->slots_[loc->idex]) Slot{std::move(value.first), std::move(value.second)};
-            // Increment size
-            ++this->size_;
-            return this->iteratorAt(loc->idex);
+        StoredSlot* slots() {
+            return this->table.data();
         }
-        return std::nullopt;
-    }
 
-    /**
-     * @brief Insert a slot rvalue.
-     * 
-     * @param slot Slot to insert.
-     * @return Iterator to the inserted slot, or std::nullopt if key already exists.
-     */
-    std::optional<iterator> insertUnchecked(Slot &&slot) {
-        if (auto loc = this->locationForInsertion(slot.first)) {
-            // Insert value into slot. Update the metadata with the hash data.
-            this->metadata_[loc->idex] = loc->h2;
-            // Move old slot into new slot.
-            new (&this->slots_[loc->idex]) Slot{std::move(slot)};
-            // Increment size
-            ++this->size_;
-            return this->iteratorAt(loc->idex);
+        Slot &element(size_t idex) {
+            return Storage::element(this->slots()[idex]);
         }
-        return std::nullopt;
-    }
+
+        size_t hashAt(size_t idex, const HashMap &map) {
+            if constexpr (Policy::StoreHash) {
+                static_cast<void>(map);
+                return reinterpret_cast<size_t*>(this->metadata() +
+                                                 hashesOffset(this->capacity))[idex];
+            } else {
+                return map.hashKey(keyOf(this->element(idex)));
+            }
+        }
+
+        size_t capacity;
+        size_t size;
+        size_t cursor = 0;
+        Table table;
+    };
+
+    using OldTableAlloc = typename AllocTraits::template rebind_alloc<OldTable>;
+    using OldTableAllocTraits = std::allocator_traits<OldTableAlloc>;
 
     /**
-     * @brief Destroy the slot at an index. Update the metadata and call the slot destructor.
-     * 
-     * @param idex Index to destroy at.
+     * @brief Destroy the old table, if any, and return it to the allocator.
      */
-    void destroySlot(size_t idex) {
-        // Mark slot as deleted
-        this->metadata_[idex] = detail::Metadata::Deleted;
-        ++this->deletedCount_;
-        // Call destructor on slot entry
-        this->slots_[idex].~Slot();
+    void resetOldTable() {
+        if (this->old_ == nullptr) {
+            return;
+        }
+        OldTableAlloc alloc(this->get_allocator());
+        OldTableAllocTraits::destroy(alloc, this->old_);
+        OldTableAllocTraits::deallocate(alloc, this->old_, 1);
+        this->old_ = nullptr;
     }
 
     /**
-     * @brief Get an iterator to an internal HashTable index.
+     * @brief Start an incremental resize: keep the current table as the old table
+     * and continue with an empty table of a larger capacity.
+     *
+     * @param newCapacity Capacity of the new table.
      */
-    inline iterator iteratorAt(size_t idex) {
-        return iterator(idex, this->slots_.data() + idex);
+    void startMigration(size_t newCapacity) {
+        assert(!this->old_);
+        this->recordGrow();
+        Allocator alloc = this->get_allocator();
+        if (!this->empty()) {
+            OldTableAlloc tableAlloc(alloc);
+            OldTable* table = OldTableAllocTraits::allocate(tableAlloc, 1);
+            OldTableAllocTraits::construct(tableAlloc,
+                                           table,
+                                           this->capacity_,
+                                           std::move(this->table_),
+                                           this->size_);
+            this->old_ = table;
+        }
+        this->capacity_ = newCapacity;
+        this->table_ = makeTable(newCapacity, alloc);
+        this->deletedCount_ = 0;
+        this->resetMetadata();
+        this->migrateStep();
     }
 
     /**
-     * @brief Get an iterator to an internal HashTable index.
+     * @brief Migrate up to MigrationBatchSize old slots into the current table.
      */
-    inline const_iterator iteratorAt(size_t idex) const {
-        return const_iterator(idex, this->slots_.data() + idex);
+    void migrateStep() {
+        if (!this->old_) {
+            return;
+        }
+        size_t end =
+            std::min(this->old_->cursor + Policy::MigrationBatchSize, this->old_->capacity);
+        for (; this->old_->cursor < end && this->old_->size != 0; ++this->old_->cursor) {
+            if (!detail::IsFree(this->old_->metadata()[this->old_->cursor])) {
+                this->migrateSlot(this->old_->cursor);
+            }
+        }
+        if (this->old_->cursor == this->old_->capacity || this->old_->size == 0) {
+            // Migration finished
+            this->resetOldTable();
+        }
     }
 
     /**
-     * @brief Get an iterator to an internal HashTable index. Returns iterator to end
-     * if value is not set.
+     * @brief Erase an element that is still in the table being migrated from.
      */
-    inline iterator iteratorAt(std::optional<size_t> maybeIdex) {
-        if (maybeIdex) {
-            return iteratorAt(*maybeIdex);
-        }
-        return this->end();
+    void eraseOld(size_t oldIdex) {
+        SlotAlloc alloc = this->table_.get_allocator();
+        Storage::destroy(alloc, &this->old_->slots()[oldIdex]);
+        detail::SetMetadata(
+            this->old_->metadata(), this->old_->capacity, oldIdex, detail::Metadata::Deleted);
+        --this->old_->size;
     }
 
     /**
-     * @brief Get an iterator to an internal HashTable index. Returns iterator to end
-     * if value is not set.
+     * @brief Migrate every remaining old slot into the current table.
      */
-    inline const_iterator iteratorAt(std::optional<size_t> maybeIdex) const {
-        if (maybeIdex) {
-            return iteratorAt(*maybeIdex);
+    void finishMigration() {
+        while (this->old_) {
+            this->migrateStep();
         }
-        return this->end();
     }
 
     /**
-     * @brief Find a key in the HashTable.
-     * 
-     * @param key Key to find.
-     * @return Internal HashTable index of key-value, or std::nullopt if not found.
+     * @brief Move a single element from the old table into the current table.
+     *
+     * @param oldIdex Index of the element in the old table.
+     * @return Internal HashTable index of the moved element.
      */
-    std::optional<size_t> doFind(const K &key) const {
-        if (this->empty()) {
-            return std::nullopt;
-        }
-        Hash hasher;
-        Eq eq;
-        size_t hash = hasher(key);
-        auto h1 = detail::H1(hash);
-        auto h2 = detail::H2(hash);
-
-        size_t idex = h1 % this->capacity_;
-        while (true) {
-            auto metadata = this->metadata_[idex];
-            if (metadata == h2 && eq(key, this->slots_[idex].first)) {
-                // Found key
-                return idex;
-            } else if (metadata == detail::Metadata::Empty) {
-                // Found empty slot, must not be in hash table
-                return std::nullopt;
-            }
-            idex = (idex + 1) % this->capacity_;
-        }
+    size_t migrateSlot(size_t oldIdex) {
+        size_t idex =
+            this->transferNew(this->old_->hashAt(oldIdex, *this), &this->old_->slots()[oldIdex]);
+        // Keep probing through the old slot for other old elements
+        detail::SetMetadata(
+            this->old_->metadata(), this->old_->capacity, oldIdex, detail::Metadata::Deleted);
+        --this->old_->size;
+        return idex;
     }
 
+    // Fewest new slots per task of a parallel rehash
+    static constexpr size_t ParallelRehashRangeSize = 1 << 16;
+    static constexpr size_t MaxParallelRehashTasks = 256;
+    // Fewest keys per task hashed by bulk_insert
+    static constexpr size_t BulkHashChunkSize = 1 << 14;
+    // A throwing move could not be undone once other tasks have moved on
+    static constexpr bool CanRehashInParallel =
+        Policy::NodeStorage || std::is_nothrow_move_constructible_v<Slot>;
+
     void growOrRehash() {
-        size_t effectiveSize = this->effectiveSize();
-        if ((float)this->deletedCount_ / effectiveSize > MaxDeletedLoadFactor) {
+        if constexpr (Policy::IncrementalResize) {
+            // A resize still in progress must finish before starting another
+            this->finishMigration();
+        }
+        if (this->deletedCount_ != 0 &&
+            this->deletedCount_ >= this->tuning_.minDeletedRehashFraction * this->effectiveSize()) {
             // A lot of capacity is being used by deleted slots, rehash everything
             this->rehashEverything();
         } else {
@@ -532,14 +3384,23 @@ private:
     }
 
     /**
-     * @brief Double the capacity and rehash the table.
+     * @brief Double the capacity and rehash the table. With IncrementalResize,
+     * elements are instead migrated over the following mutating operations.
      */
     void growAndRehash() {
-        size_t newCapacity = static_cast<size_t>(this->capacity_ * GrowthFactor);
+        size_t newCapacity = std::max(
+            this->capacity_ + 1, static_cast<size_t>(this->capacity_ * this->tuning_.growthFactor));
         if (this->capacity_ == 0) {
             newCapacity = DefaultInitialCapacity;
         }
-        this->growAndRehash(newCapacity);
+        if constexpr (Policy::IncrementalResize) {
+            newCapacity = normalizeCapacity(newCapacity);
+            if (newCapacity > this->capacity_) {
+                this->startMigration(newCapacity);
+            }
+        } else {
+            this->growAndRehash(newCapacity);
+        }
     }
 
     /**
@@ -548,20 +3409,41 @@ private:
      * @param newCapacity 
      */
     void growAndRehash(size_t newCapacity) {
+        if constexpr (Policy::ParallelRehashThreshold != 0 && CanRehashInParallel) {
+            if (newCapacity >= Policy::ParallelRehashThreshold) {
+                this->growAndRehash(newCapacity, ThreadExecutor());
+                return;
+            }
+        }
+        newCapacity = normalizeCapacity(newCapacity);
         if (newCapacity <= this->capacity_) {
             return;
         }
+        this->resize(newCapacity);
+    }
+
+    /**
+     * @brief Rehash the table into a new table of any capacity.
+     */
+    void resize(size_t newCapacity) {
+        if constexpr (Policy::IncrementalResize) {
+            this->finishMigration();
+        }
 
+        if (newCapacity > this->capacity_) {
+            this->recordGrow();
+        } else {
+            this->recordShrink();
+        }
         // Temporary new table to move existing elements into
-        HashMap<K, V, Hash, Eq> newTable(newCapacity);
+        HashMap newTable = this->emptyLike(newCapacity, this->get_allocator());
 
         if (!this->empty()) {
             for (size_t i = 0; i < this->capacity_; ++i) {
-                if (!detail::IsFree(this->metadata_[i])) {
+                if (!detail::IsFree(this->metadata()[i])) {
                     // Move slot data into new table
-                    newTable.insertUnchecked(std::move(this->slots_[i]));
-                    // Call destructor on residual slot
-                    this->slots_[i].~Slot();
+                    newTable.transferNew(this->hashAt(i), &this->slots()[i]);
+                    ++newTable.size_;
                     // Decrement size to avoid additional cleanup when *this is dropped
                     --this->size_;
                 }
@@ -569,33 +3451,264 @@ private:
         }
 
         // Swap internals with temporary table
-        *this = std::move(newTable);
+        this->assignFrom(std::move(newTable));
+    }
+
+    /**
+     * @brief Increase the capacity and rehash the table, moving elements on an
+     * executor. Falls back to a serial rehash if moving an element may throw.
+     */
+    template <typename Executor>
+    void growAndRehash(size_t newCapacity, Executor &&executor) {
+        if constexpr (!CanRehashInParallel) {
+            static_cast<void>(executor);
+            this->growAndRehash(newCapacity);
+        } else {
+            newCapacity = normalizeCapacity(newCapacity);
+            if (newCapacity <= this->capacity_) {
+                return;
+            }
+            if constexpr (Policy::IncrementalResize) {
+                this->finishMigration();
+            }
+            this->recordGrow();
+            HashMap newTable = this->emptyLike(newCapacity, this->get_allocator());
+            if (!this->empty()) {
+                newTable.parallelTransferFrom(*this, executor);
+            }
+            this->assignFrom(std::move(newTable));
+        }
+    }
+
+    /**
+     * @brief Move every element of another table into this empty table in
+     * parallel, leaving the other table without elements.
+     *
+     * Both tables are split into one range per task. First, each task hashes
+     * the elements of its old range and counts where they land in the new
+     * table. The elements are then ordered by destination range, and each task
+     * places the elements bound for its range, probing only groups that lie
+     * entirely within the range. Elements whose probe leaves their range are
+     * placed serially once every task is done.
+     */
+    template <typename Executor>
+    void parallelTransferFrom(HashMap &source, Executor &executor) {
+        assert(this->empty() && this->capacity_ > source.capacity_);
+        size_t numTasks = std::clamp<size_t>(
+            this->capacity_ / ParallelRehashRangeSize, 1, MaxParallelRehashTasks);
+        size_t oldCapacity = source.capacity_;
+        size_t newCapacity = this->capacity_;
+        auto oldBegin = [&](size_t t) { return t * oldCapacity / numTasks; };
+        auto newBegin = [&](size_t t) { return t * newCapacity / numTasks; };
+        auto rangeOf = [&](size_t hash) {
+            size_t home = ProbeSeq(detail::H1(hash), newCapacity).offset();
+            return std::min(home * numTasks / newCapacity, numTasks - 1);
+        };
+
+        // Hashes of the old elements, unless the old table already stores them
+        std::unique_ptr<size_t[]> scratchHashes;
+        if constexpr (!Policy::StoreHash) {
+            scratchHashes.reset(new size_t[oldCapacity]);
+        }
+        auto hashOf = [&](size_t i) {
+            if constexpr (Policy::StoreHash) {
+                return source.hashAt(i);
+            } else {
+                return scratchHashes[i];
+            }
+        };
+
+        // counts[t * numTasks + r] is the number of elements of old range t
+        // bound for new range r, then where they start in order
+        std::vector<size_t> counts(numTasks * numTasks, 0);
+        executor(numTasks, [&](size_t t) {
+            for (size_t i = oldBegin(t); i < oldBegin(t + 1); ++i) {
+                if (detail::IsFree(source.metadata()[i])) {
+                    continue;
+                }
+                if constexpr (!Policy::StoreHash) {
+                    scratchHashes[i] = this->hashKey(keyOf(source.element(i)));
+                }
+                ++counts[t * numTasks + rangeOf(hashOf(i))];
+            }
+        });
+
+        // Order elements by new range, then by old range
+        std::vector<size_t> rangeStart(numTasks + 1);
+        size_t total = 0;
+        for (size_t r = 0; r < numTasks; ++r) {
+            rangeStart[r] = total;
+            for (size_t t = 0; t < numTasks; ++t) {
+                size_t count = counts[t * numTasks + r];
+                counts[t * numTasks + r] = total;
+                total += count;
+            }
+        }
+        rangeStart[numTasks] = total;
+        assert(total == source.size_);
+
+        std::unique_ptr<size_t[]> order(new size_t[total]);
+        executor(numTasks, [&](size_t t) {
+            for (size_t i = oldBegin(t); i < oldBegin(t + 1); ++i) {
+                if (!detail::IsFree(source.metadata()[i])) {
+                    order[counts[t * numTasks + rangeOf(hashOf(i))]++] = i;
+                }
+            }
+        });
+
+        // Placed elements are cleared from the order, leaving the elements
+        // whose probe left their range
+        constexpr size_t Placed = SIZE_MAX;
+        executor(numTasks, [&](size_t r) {
+            // Groups must not reach the sentinel and cloned bytes, which belong
+            // to no range
+            size_t begin = newBegin(r);
+            size_t end = newBegin(r + 1);
+            for (size_t k = rangeStart[r]; k < rangeStart[r + 1]; ++k) {
+                size_t i = order[k];
+                size_t hash = hashOf(i);
+                ProbeSeq seq(detail::H1(hash), newCapacity);
+                while (true) {
+                    if (seq.offset() < begin || seq.offset() + detail::Group::Width > end) {
+                        break;
+                    }
+                    detail::Group group(this->metadata() + seq.offset());
+                    if (auto free = group.matchEmptyOrDeleted()) {
+                        size_t idex = seq.offset(free.lowestBitSet());
+                        this->markFull(InsertionLoc{idex, hash, true});
+                        this->transferSlot(&this->slots()[idex], &source.slots()[i]);
+                        order[k] = Placed;
+                        break;
+                    }
+                    seq.next();
+                }
+            }
+        });
+
+        for (size_t k = 0; k < total; ++k) {
+            if (order[k] != Placed) {
+                this->transferNew(hashOf(order[k]), &source.slots()[order[k]]);
+            }
+        }
+        this->size_ = source.size_;
+        // Every element was moved out
+        source.size_ = 0;
     }
 
     /**
-     * @brief Rehash the HashTable without changing capacity.
+     * @brief Rehash the HashTable in place without changing capacity, dropping
+     * every deleted slot. Does not allocate.
+     *
+     * Full slots are first marked Deleted and deleted slots marked Empty. Each
+     * marked element is then moved to the first free slot of its probe sequence,
+     * swapping with another marked element if that slot holds one.
      */
     void rehashEverything() {
+        this->recordRehash();
         if (this->empty()) {
+            this->resetMetadata();
+            this->deletedCount_ = 0;
             return;
         }
 
-        // Temporary new table to move existing elements into
-        HashMap<K, V, Hash, Eq> newTable(this->capacity_);
+        this->convertDeletedToEmptyAndFullToDeleted();
+
+        // Scratch space for swapping two elements
+        alignas(StoredSlot) unsigned char tmp[sizeof(StoredSlot)];
+        auto* tmpSlot = reinterpret_cast<StoredSlot*>(tmp);
+
         for (size_t i = 0; i < this->capacity_; ++i) {
-            if (!detail::IsFree(this->metadata_[i])) {
-                // Move slot data into new table
-                newTable.insertUnchecked(std::move(this->slots_[i]));
-                // Call destructor on residual slot
-                this->slots_[i].~Slot();
-                // Decrement size to avoid additional cleanup when *this is dropped
-                --this->size_;
+            if (this->metadata()[i] != detail::Metadata::Deleted) {
+                continue;
+            }
+            size_t hash = this->hashAt(i);
+            auto h2 = detail::H2(hash);
+            ProbeSeq seq(detail::H1(hash), this->capacity_);
+            size_t probeOffset = seq.offset();
+            size_t newIdex = this->findFirstNonFull(seq);
+
+            // Index of the group a slot falls in, relative to the start of the probe
+            auto probeIndex = [&](size_t idex) {
+                size_t ringSize = this->capacity_ + 1;
+                return ((idex + ringSize - probeOffset) % ringSize) / detail::Group::Width;
+            };
+
+            if (probeIndex(i) == probeIndex(newIdex)) {
+                // Element is already in the best group it can be in
+                this->setMetadata(i, h2);
+                continue;
+            }
+
+            if (this->metadata()[newIdex] == detail::Metadata::Empty) {
+                // Move element into the empty slot
+                this->setMetadata(newIdex, h2);
+                this->transferSlot(&this->slots()[newIdex], &this->slots()[i]);
+                this->storeHash(newIdex, hash);
+                this->setMetadata(i, detail::Metadata::Empty);
+            } else {
+                // Target holds an element that has not been placed yet. Swap the
+                // two and process slot i again.
+                assert(this->metadata()[newIdex] == detail::Metadata::Deleted);
+                this->setMetadata(newIdex, h2);
+                this->transferSlot(tmpSlot, &this->slots()[i]);
+                this->transferSlot(&this->slots()[i], &this->slots()[newIdex]);
+                this->transferSlot(&this->slots()[newIdex], tmpSlot);
+                if constexpr (Policy::StoreHash) {
+                    std::swap(this->hashes()[i], this->hashes()[newIdex]);
+                }
+                --i;
             }
         }
 
-        assert(this->size_ == 0);
-        // Swap internals with temporary table
-        *this = std::move(newTable);
+        this->deletedCount_ = 0;
+    }
+
+    /**
+     * @brief Mark full slots as Deleted and deleted slots as Empty.
+     */
+    void convertDeletedToEmptyAndFullToDeleted() {
+        for (size_t i = 0; i < this->capacity_; ++i) {
+            this->metadata()[i] = detail::IsFree(this->metadata()[i]) ? detail::Metadata::Empty
+                                                                   : detail::Metadata::Deleted;
+        }
+        // Mirror the converted bytes into the cloned tail
+        size_t cloned = std::min(this->capacity_, detail::NumClonedBytes);
+        std::copy_n(this->metadata(), cloned, this->metadata() + this->capacity_ + 1);
+    }
+
+    /**
+     * @brief Find the first Empty or Deleted slot on a probe sequence.
+     *
+     * @param seq Probe sequence to follow.
+     * @return Internal HashTable index of the free slot.
+     */
+    size_t findFirstNonFull(ProbeSeq &seq) const {
+        while (true) {
+            detail::Group group(this->metadata() + seq.offset());
+            if (auto free = group.matchEmptyOrDeleted()) {
+                return seq.offset(free.lowestBitSet());
+            }
+            seq.next();
+        }
+    }
+
+    /**
+     * @brief Move-construct the element at src into dst and destroy the element at src.
+     */
+    void transferSlot(StoredSlot* dst, StoredSlot* src) {
+        SlotAlloc alloc = this->table_.get_allocator();
+        Storage::transfer(alloc, dst, src);
+    }
+
+    /**
+     * @brief Round a requested capacity up to one the policy supports.
+     */
+    static constexpr size_t normalizeCapacity(size_t capacity) {
+        if constexpr (Policy::PowerOfTwoCapacity) {
+            return detail::NormalizeCapacity(capacity);
+        } else {
+            return capacity;
+        }
     }
 
     size_t effectiveSize() const {
@@ -610,34 +3723,133 @@ private:
     }
 
     /**
-     * @brief Compute the load factor after an insertion.
+     * @brief Get the most elements and deleted slots a table of a capacity may
+     * hold at the max load factor. At least one slot always stays empty, so
+     * that probes terminate.
+     */
+    size_t capacityToGrowth(size_t capacity) const {
+        if (capacity == 0) {
+            return 0;
+        }
+        auto growth = static_cast<size_t>(capacity * this->tuning_.maxLoadFactor);
+        return std::min(capacity - 1, growth);
+    }
+
+    /**
+     * @brief Get the size below which erasures shrink a table of a capacity.
+     * Capped at a quarter of the max load factor, since shrinks land at half
+     * of it.
      */
-    float loadFactorAfterInsertion() const {
-        return ((float)(this->size_ + 1)) / this->capacity_;
+    size_t capacityToShrink(size_t capacity) const {
+        if (capacity <= normalizeCapacity(DefaultInitialCapacity)) {
+            return 0;
+        }
+        float loadFactor =
+            std::min(this->tuning_.shrinkLoadFactor, this->tuning_.maxLoadFactor / 4);
+        return static_cast<size_t>(capacity * loadFactor);
+    }
+
+    void updateLimits() {
+        this->growthLimit_ = this->capacityToGrowth(this->capacity_);
+        this->shrinkLimit_ = this->capacityToShrink(this->capacity_);
     }
 
     /**
-     * @brief Check whether the load factor is too high and we need to rehash.
+     * @brief Get the smallest capacity that holds n elements at the max load factor.
      */
-    bool needRehash() const {
-        static_assert(MaxLoadFactor <= 1);
-        return this->effectiveLoadFactor() >= MaxLoadFactor || this->capacity_ == 0;
+    size_t capacityFor(size_t n) const {
+        if (n == 0) {
+            return 0;
+        }
+        size_t capacity = normalizeCapacity(
+            static_cast<size_t>(n / this->tuning_.maxLoadFactor) + 1);
+        // Make up for rounding in the division
+        while (this->capacityToGrowth(capacity) < n) {
+            capacity = normalizeCapacity(capacity + 1);
+        }
+        return capacity;
     }
 
     /**
-     * @brief Check whether the load factor will be too high after an insertion.
+     * @brief Get the number of insertions into empty slots left before the
+     * table must grow or rehash.
      */
-    bool needRehashBeforeInsertion() const {
-        return this->loadFactorAfterInsertion() >= MaxLoadFactor || this->capacity_ == 0;
+    size_t growthLeft() const {
+        size_t used = this->effectiveSize();
+        return used >= this->growthLimit_ ? 0 : this->growthLimit_ - used;
     }
 
+    /**
+     * @brief Load factor and growth tuning, defaulting to the policy's.
+     */
+    struct Tuning {
+        float maxLoadFactor = MaxLoadFactor;
+        float growthFactor = GrowthFactor;
+        float minDeletedRehashFraction = MinDeletedRehashFraction;
+        float shrinkLoadFactor = ShrinkLoadFactor;
+    };
+
     size_t capacity_;
     size_t size_;
 
-    std::vector<detail::metadata_t> metadata_;
-    FixedUninitVec<Slot> slots_;
+    Table table_;
 
     size_t deletedCount_;
+
+    // Table being migrated from during an incremental resize
+    OldTable* old_ = nullptr;
+
+    Tuning tuning_;
+    // capacityToGrowth(capacity_) and capacityToShrink(capacity_), kept so
+    // that insertions and erasures compare integers
+    size_t growthLimit_ = 0;
+    size_t shrinkLimit_ = 0;
 };
 
+/**
+ * @brief HashMap that allocates every element in its own node. Pointers and
+ * references to elements stay valid across rehashes, and growing moves only
+ * pointers.
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy,
+    typename Allocator = std::allocator<std::pair<const K, V>>>
+using NodeHashMap = HashMap<K, V, Hash, Eq, NodeHashMapPolicy<Policy>, Allocator>;
+
+#if defined(DNSGE_HASHMAP_HAVE_PMR)
+
+namespace pmr {
+
+/**
+ * @brief HashMap allocating from a std::pmr::memory_resource.
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy>
+using HashMap = dnsge::
+    HashMap<K, V, Hash, Eq, Policy, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+
+/**
+ * @brief NodeHashMap allocating from a std::pmr::memory_resource.
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy>
+using NodeHashMap = dnsge::
+    NodeHashMap<K, V, Hash, Eq, Policy, std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+
+} // namespace pmr
+
+#endif
+
 } // namespace dnsge
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "HashMap.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace dnsge {
+
+/**
+ * @brief A hash set of unique keys. Shares its table with HashMap, so it has the
+ * same probing, policies and allocator support, but its slots hold only the key.
+ *
+ * Keys are immutable once inserted, so iterator and const_iterator are the same
+ * type. Inserting or erasing keys invalidates every iterator.
+ */
+template <
+    typename K,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy,
+    typename Allocator = std::allocator<K>>
+class HashSet {
+    using Table = HashMap<K, detail::SetValue, Hash, Eq, Policy, Allocator>;
+
+public:
+    static constexpr size_t DefaultInitialCapacity = Table::DefaultInitialCapacity;
+    static constexpr float MaxLoadFactor = Table::MaxLoadFactor;
+
+    using key_type = K;
+    using value_type = K;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using allocator_type = Allocator;
+    using iterator = typename Table::const_iterator;
+    using const_iterator = typename Table::const_iterator;
+    using node_type = typename Table::node_type;
+
+    template <typename L>
+    using KeyArg = typename Table::template KeyArg<L>;
+
+    /**
+     * @brief Construct a new HashSet with a default capacity.
+     */
+    HashSet()
+        : HashSet(DefaultInitialCapacity) {}
+
+    /**
+     * @brief Construct a new HashSet with a default capacity, allocating from an allocator.
+     *
+     * @param alloc Allocator for all of the HashSet's storage.
+     */
+    explicit HashSet(const Allocator &alloc)
+        : HashSet(DefaultInitialCapacity, alloc) {}
+
+    /**
+     * @brief Construct a new HashSet with a specified capacity.
+     *
+     * @param initialCapacity Initial slot capacity.
+     * @param alloc Allocator for all of the HashSet's storage.
+     */
+    HashSet(size_t initialCapacity, const Allocator &alloc = Allocator())
+        : table_(initialCapacity, alloc) {}
+
+    /**
+     * @brief Construct a new HashSet with a specified capacity and the function
+     * objects to hash and compare keys with, such as a SeededHash.
+     *
+     * @param initialCapacity Initial slot capacity.
+     * @param hash Hash function, copied into the HashSet.
+     * @param eq Key equality function, copied into the HashSet.
+     * @param alloc Allocator for all of the HashSet's storage.
+     */
+    HashSet(size_t initialCapacity,
+            const Hash &hash,
+            const Eq &eq = Eq(),
+            const Allocator &alloc = Allocator())
+        : table_(initialCapacity, hash, eq, alloc) {}
+
+    /**
+     * @brief Construct a new HashSet holding the keys of a range.
+     *
+     * @param first Iterator to the first key.
+     * @param last Iterator past the last key.
+     * @param initialCapacity Initial slot capacity, grown once to fit the range.
+     * @param alloc Allocator for all of the HashSet's storage.
+     */
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    HashSet(InputIt first,
+            InputIt last,
+            size_t initialCapacity = DefaultInitialCapacity,
+            const Allocator &alloc = Allocator())
+        : HashSet(initialCapacity, alloc) {
+        this->insert(first, last);
+    }
+
+    /**
+     * @brief Insert a key if it is not present.
+     *
+     * @param key Key to insert.
+     * @return Iterator to the key in the set, and whether it was inserted.
+     */
+    std::pair<iterator, bool> insert(const K &key) {
+        return this->insertImpl(key);
+    }
+
+    std::pair<iterator, bool> insert(K &&key) {
+        return this->insertImpl(std::move(key));
+    }
+
+    /**
+     * @brief Insert the keys of a range.
+     */
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    void insert(InputIt first, InputIt last) {
+        if constexpr (detail::IsForwardIterator<InputIt>) {
+            this->reserve(this->size() + static_cast<size_t>(std::distance(first, last)));
+        }
+        for (; first != last; ++first) {
+            this->insert(*first);
+        }
+    }
+
+    /**
+     * @brief Construct a key from arguments and insert it if it is not present.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&...args) {
+        return this->insertImpl(K(std::forward<Args>(args)...));
+    }
+
+    template <typename L = K>
+    const_iterator find(const KeyArg<L> &key) const {
+        return this->table_.find(key);
+    }
+
+    template <typename L = K>
+    bool contains(const KeyArg<L> &key) const {
+        return this->table_.contains(key);
+    }
+
+    /**
+     * @brief Erase a key.
+     *
+     * @return Whether the key was present and erased.
+     */
+    template <typename L = K>
+    bool erase(const KeyArg<L> &key) {
+        return this->table_.erase(key);
+    }
+
+    /**
+     * @brief Erase the key an iterator points to.
+     *
+     * @return Whether the iterator pointed to a key.
+     */
+    bool erase(const_iterator it) {
+        return this->table_.erase(this->table_.mutableIterator(it));
+    }
+
+    /**
+     * @brief Erase the keys of an iterator range in one sweep.
+     *
+     * @return Number of keys erased.
+     */
+    size_t erase(const_iterator first, const_iterator last) {
+        return this->table_.erase(first, last);
+    }
+
+    /**
+     * @brief Erase every key that satisfies a predicate, in one sweep over the set.
+     *
+     * @param pred Called as pred(const K &) for every key.
+     * @return Number of keys erased.
+     */
+    template <typename Pred>
+    size_t erase_if(Pred &&pred) {
+        return this->table_.erase_if(std::forward<Pred>(pred));
+    }
+
+    /**
+     * @brief Take a key out of the set without copying it. See HashMap::extract().
+     */
+    node_type extract(const_iterator it) {
+        return this->table_.extract(it);
+    }
+
+    template <typename L = K>
+    node_type extract(const KeyArg<L> &key) {
+        return this->table_.extract(key);
+    }
+
+    /**
+     * @brief Insert the key of a node from extract(). See HashMap::insert(node_type &&).
+     *
+     * @return Iterator to the inserted key, or std::nullopt if the node is empty
+     * or the key is already present.
+     */
+    std::optional<iterator> insert(node_type &&node) {
+        auto it = this->table_.insert(std::move(node));
+        if (!it) {
+            return std::nullopt;
+        }
+        return iterator(*it);
+    }
+
+    /**
+     * @brief Move every key of source that is absent from this set into it. See
+     * HashMap::merge().
+     *
+     * @return Number of keys moved.
+     */
+    size_t merge(HashSet &source) {
+        return this->table_.merge(source.table_);
+    }
+
+    size_t merge(HashSet &&source) {
+        return this->table_.merge(source.table_);
+    }
+
+    void clear() {
+        this->table_.clear();
+    }
+
+    /**
+     * @brief Grow the set so that it can hold at least n keys without growing.
+     */
+    void reserve(size_t n) {
+        this->table_.reserve(n);
+    }
+
+    /**
+     * @brief Rehash the set into at least n slots, shrinking it if n is small.
+     * See HashMap::rehash().
+     */
+    void rehash(size_t n) {
+        this->table_.rehash(n);
+    }
+
+    void shrink_to_fit() {
+        this->table_.shrink_to_fit();
+    }
+
+    size_t size() const {
+        return this->table_.size();
+    }
+
+    bool empty() const {
+        return this->table_.empty();
+    }
+
+    size_t capacity() const {
+        return this->table_.capacity();
+    }
+
+    const_iterator begin() const {
+        return this->table_.begin();
+    }
+
+    const_iterator end() const {
+        return this->table_.end();
+    }
+
+    const_iterator cbegin() const {
+        return this->table_.cbegin();
+    }
+
+    const_iterator cend() const {
+        return this->table_.cend();
+    }
+
+    hasher hash_function() const {
+        return this->table_.hash_function();
+    }
+
+    key_equal key_eq() const {
+        return this->table_.key_eq();
+    }
+
+    /**
+     * @brief Get the statistics of the HashSet. See HashMap::stats().
+     */
+    HashMapStats stats() const {
+        return this->table_.stats();
+    }
+
+    allocator_type get_allocator() const {
+        return this->table_.get_allocator();
+    }
+
+private:
+    template <typename KArg>
+    std::pair<iterator, bool> insertImpl(KArg &&key) {
+        auto loc = this->table_.findOrPrepareInsert(key);
+        if (!loc.free) {
+            return {this->table_.iteratorAt(loc.idex), false};
+        }
+        return {this->table_.constructAt(loc, std::forward<KArg>(key)), true};
+    }
+
+    Table table_;
+};
+
+#if defined(DNSGE_HASHMAP_HAVE_PMR)
+
+namespace pmr {
+
+/**
+ * @brief HashSet allocating from a std::pmr::memory_resource.
+ */
+template <
+    typename K,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy>
+using HashSet = dnsge::HashSet<K, Hash, Eq, Policy, std::pmr::polymorphic_allocator<K>>;
+
+} // namespace pmr
+
+#endif
+
+} // namespace dnsge
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "HashMap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dnsge {
+
+/**
+ * @brief A read-only HashMap served straight from a snapshot file written by
+ * HashMap::save(). The file is mapped into memory with mmap, so lookups work as
+ * soon as it is opened and pages are faulted in as lookups touch them.
+ *
+ * Hash, Eq and Policy must match the HashMap that wrote the snapshot, and so
+ * must the seed of a seeded hasher. Opening throws std::runtime_error if the
+ * file cannot be mapped or its layout does not match. Requires POSIX.
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy>
+class MappedHashMap {
+public:
+    using Map = HashMap<K, V, Hash, Eq, Policy>;
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = typename Map::value_type;
+
+    static_assert(!Policy::NodeStorage, "Snapshots require inline storage");
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "Snapshots require trivially copyable keys and values");
+
+    /**
+     * @brief Map a snapshot file into memory.
+     *
+     * @param path Path of the snapshot file.
+     * @param hash Hash function the snapshot was built with.
+     * @param eq Key equality function.
+     */
+    explicit MappedHashMap(const std::string &path, const Hash &hash = Hash(), const Eq &eq = Eq())
+        : hash_(hash)
+        , eq_(eq) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open HashMap snapshot " + path);
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("truncated HashMap snapshot " + path);
+        }
+        this->length_ = static_cast<size_t>(st.st_size);
+        void* base = ::mmap(nullptr, this->length_, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid without the descriptor
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("failed to map HashMap snapshot " + path);
+        }
+        this->base_ = static_cast<const unsigned char*>(base);
+
+        const auto* header = reinterpret_cast<const Header*>(this->base_);
+        if (!this->isCompatible(*header)) {
+            this->unmap();
+            throw std::runtime_error("incompatible HashMap snapshot " + path);
+        }
+        this->capacity_ = header->capacity;
+        this->size_ = header->size;
+        this->metadata_ = this->base_ + sizeof(Header);
+        this->slots_ = reinterpret_cast<const value_type*>(this->base_ + header->slotsOffset);
+    }
+
+    ~MappedHashMap() {
+        this->unmap();
+    }
+
+    MappedHashMap(const MappedHashMap &other) = delete;
+    MappedHashMap &operator=(const MappedHashMap &other) = delete;
+
+    MappedHashMap(MappedHashMap &&other) noexcept
+        : hash_(std::move(other.hash_))
+        , eq_(std::move(other.eq_))
+        , base_(std::exchange(other.base_, nullptr))
+        , length_(std::exchange(other.length_, 0))
+        , capacity_(std::exchange(other.capacity_, 0))
+        , size_(std::exchange(other.size_, 0))
+        , metadata_(std::exchange(other.metadata_, nullptr))
+        , slots_(std::exchange(other.slots_, nullptr)) {}
+
+    MappedHashMap &operator=(MappedHashMap &&other) noexcept {
+        if (this != &other) {
+            this->unmap();
+            this->hash_ = std::move(other.hash_);
+            this->eq_ = std::move(other.eq_);
+            this->base_ = std::exchange(other.base_, nullptr);
+            this->length_ = std::exchange(other.length_, 0);
+            this->capacity_ = std::exchange(other.capacity_, 0);
+            this->size_ = std::exchange(other.size_, 0);
+            this->metadata_ = std::exchange(other.metadata_, nullptr);
+            this->slots_ = std::exchange(other.slots_, nullptr);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Find the element of a key.
+     *
+     * @param key Key to look up.
+     * @return Pointer to the element in the mapping, or nullptr if not found.
+     */
+    template <typename L = K>
+    const value_type* find(const typename Map::template KeyArg<L> &key) const {
+        if (this->size_ == 0) {
+            return nullptr;
+        }
+        auto idex = Map::findInTable(key,
+                                     Map::mixHash(this->hash_(key)),
+                                     this->metadata_,
+                                     this->slots_,
+                                     this->capacity_,
+                                     this->eq_);
+        return idex ? &this->slots_[*idex] : nullptr;
+    }
+
+    template <typename L = K>
+    bool contains(const typename Map::template KeyArg<L> &key) const {
+        return this->find(key) != nullptr;
+    }
+
+    /**
+     * @brief Get the value of a key. Throws std::out_of_range if the key is not
+     * present.
+     */
+    template <typename L = K>
+    const V &at(const typename Map::template KeyArg<L> &key) const {
+        if (const value_type* slot = this->find(key)) {
+            return slot->second;
+        }
+        throw std::out_of_range("key not found");
+    }
+
+    size_t size() const {
+        return this->size_;
+    }
+
+    bool empty() const {
+        return this->size_ == 0;
+    }
+
+    size_t capacity() const {
+        return this->capacity_;
+    }
+
+private:
+    using Header = detail::SnapshotHeader;
+
+    /**
+     * @brief Check that a snapshot was written with this layout and fits in the
+     * mapping.
+     */
+    bool isCompatible(const Header &header) const {
+        if (std::memcmp(header.magic, Header::Magic, sizeof(header.magic)) != 0 ||
+            header.version != Header::LayoutVersion ||
+            header.flags != Header::flagsOf<Policy>() ||
+            header.groupWidth != detail::Group::Width || header.slotSize != sizeof(value_type) ||
+            header.slotAlignment != alignof(value_type) ||
+            header.hashSeed != detail::HashSeedOf(this->hash_)) {
+            return false;
+        }
+        size_t capacity = header.capacity;
+        size_t metadataBytes = 0;
+        if (capacity != 0) {
+            metadataBytes = Map::hashesOffset(capacity);
+            if constexpr (Policy::StoreHash) {
+                metadataBytes += capacity * sizeof(size_t);
+            }
+        }
+        return header.metadataBytes == metadataBytes &&
+               header.slotsOffset == Map::snapshotSlotsOffset(metadataBytes) &&
+               header.slotsOffset + capacity * sizeof(value_type) <= this->length_;
+    }
+
+    void unmap() {
+        if (this->base_ != nullptr) {
+            ::munmap(const_cast<unsigned char*>(this->base_), this->length_);
+        }
+        this->base_ = nullptr;
+    }
+
+    Hash hash_;
+    Eq eq_;
+    const unsigned char* base_ = nullptr;
+    size_t length_ = 0;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    const detail::metadata_t* metadata_ = nullptr;
+    const value_type* slots_ = nullptr;
+};
+
+template <typename K, typename V, typename Hash, typename Eq, typename Policy, typename Allocator>
+MappedHashMap<K, V, Hash, Eq, Policy>
+HashMap<K, V, Hash, Eq, Policy, Allocator>::map_readonly(const std::string &path,
+                                                        const Hash &hash,
+                                                        const Eq &eq) {
+    return MappedHashMap<K, V, Hash, Eq, Policy>(path, hash, eq);
+}
+
+} // namespace dnsge
@@ -0,0 +1,340 @@
+#pragma once
+
+#include "HashMap.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dnsge {
+
+namespace detail {
+
+/**
+ * @brief Process-wide epoch-based reclamation. Each thread that reads owns one
+ * cache-line-sized slot, where it publishes the epoch it entered at while it
+ * reads. Readers only ever write their own slot, so reads do not bounce any
+ * cache line between cores. A writer retires an object at the epoch after it
+ * unpublished it, and frees it once no slot is still at an earlier epoch.
+ */
+class EpochDomain {
+    // Slot value of a thread that is not reading
+    static constexpr uint64_t Quiescent = 0;
+
+    struct alignas(CacheLineSize) Slot {
+        std::atomic<uint64_t> epoch{Quiescent};
+        std::atomic<bool> owned{false};
+    };
+
+public:
+    static constexpr size_t MaxThreads = 256;
+
+    /**
+     * @brief Marks the calling thread as reading for its lifetime. Nested guards
+     * keep the outermost epoch, which is the more conservative one.
+     */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(EpochDomain &domain)
+            : slot_(domain.threadSlot())
+            , previous_(slot_.epoch.load(std::memory_order_relaxed)) {
+            if (this->previous_ == Quiescent) {
+                this->slot_.epoch.store(domain.epoch_.load(std::memory_order_acquire),
+                                        std::memory_order_relaxed);
+                // Order the store before the reads it protects; pairs with the
+                // fence in minActiveEpoch
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        ~ReadGuard() {
+            if (this->previous_ == Quiescent) {
+                this->slot_.epoch.store(Quiescent, std::memory_order_release);
+            }
+        }
+
+        ReadGuard(const ReadGuard &other) = delete;
+        ReadGuard &operator=(const ReadGuard &other) = delete;
+
+    private:
+        Slot &slot_;
+        uint64_t previous_;
+    };
+
+    /**
+     * @brief Start a new epoch after an object was unpublished.
+     *
+     * @return The epoch at which the object may be freed once no reader is
+     * still in an earlier one.
+     */
+    uint64_t advance() {
+        // Order the unpublishing store before the epoch change and the scan in
+        // minActiveEpoch
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return this->epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+    /**
+     * @brief Get the earliest epoch a thread is currently reading in, or
+     * UINT64_MAX if no thread is reading.
+     */
+    uint64_t minActiveEpoch() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t min = UINT64_MAX;
+        for (const Slot &slot : this->slots_) {
+            uint64_t epoch = slot.epoch.load(std::memory_order_acquire);
+            if (epoch != Quiescent && epoch < min) {
+                min = epoch;
+            }
+        }
+        return min;
+    }
+
+    static EpochDomain &global() {
+        static EpochDomain domain;
+        return domain;
+    }
+
+private:
+    /**
+     * @brief Owns a slot for the lifetime of a thread.
+     */
+    struct Registration {
+        explicit Registration(EpochDomain &domain) {
+            for (Slot &slot : domain.slots_) {
+                bool expected = false;
+                if (slot.owned.compare_exchange_strong(expected, true,
+                                                       std::memory_order_acquire)) {
+                    this->slot = &slot;
+                    return;
+                }
+            }
+            throw std::length_error("too many threads reading through EpochDomain");
+        }
+
+        ~Registration() {
+            this->slot->owned.store(false, std::memory_order_release);
+        }
+
+        Slot* slot = nullptr;
+    };
+
+    Slot &threadSlot() {
+        assert(this == &EpochDomain::global());
+        thread_local Registration registration(*this);
+        return *registration.slot;
+    }
+
+    std::atomic<uint64_t> epoch_{1};
+    Slot slots_[MaxThreads];
+};
+
+} // namespace detail
+
+/**
+ * @brief A thread-safe HashMap for tables that are read far more often than
+ * they are written. Readers run against an immutable snapshot of the map
+ * without taking a lock or writing any memory shared with other readers, and
+ * never wait for a writer.
+ *
+ * Writers are serialized by a mutex and copy the current snapshot, modify the
+ * copy, and publish it. Superseded snapshots are freed once every reader that
+ * could still see them has finished, through epoch-based reclamation. Every
+ * write therefore costs a copy of the map; batch changes through update.
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy,
+    typename Allocator = std::allocator<std::pair<const K, V>>>
+class ReadMostlyHashMap {
+public:
+    using Map = HashMap<K, V, Hash, Eq, Policy, Allocator>;
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = typename Map::value_type;
+
+    explicit ReadMostlyHashMap(const Allocator &alloc = Allocator())
+        : current_(new Map(alloc)) {}
+
+    /**
+     * @brief Construct a new ReadMostlyHashMap with the function objects to hash
+     * and compare keys with, such as a SeededHash.
+     */
+    explicit ReadMostlyHashMap(const Hash &hash,
+                               const Eq &eq = Eq(),
+                               const Allocator &alloc = Allocator())
+        : current_(new Map(Map::DefaultInitialCapacity, hash, eq, alloc)) {}
+
+    /**
+     * @brief Destroy the map. No thread may be reading it concurrently.
+     */
+    ~ReadMostlyHashMap() {
+        delete this->current_.load(std::memory_order_relaxed);
+    }
+
+    ReadMostlyHashMap(const ReadMostlyHashMap &other) = delete;
+    ReadMostlyHashMap &operator=(const ReadMostlyHashMap &other) = delete;
+
+    /**
+     * @brief Copy the value of a key out of the map.
+     *
+     * @param key Key to look up.
+     * @return The value, or std::nullopt if the key is not present.
+     */
+    std::optional<V> get(const K &key) const {
+        std::optional<V> value;
+        this->visit(key, [&](const value_type &slot) { value = slot.second; });
+        return value;
+    }
+
+    /**
+     * @brief Check whether a key is present.
+     */
+    bool contains(const K &key) const {
+        return this->read([&](const Map &map) { return map.contains(key); });
+    }
+
+    /**
+     * @brief Call f with the element of a key in the current snapshot.
+     *
+     * @param key Key to look up.
+     * @param f Called as f(const value_type &) if the key is present.
+     * @return Whether the key was present.
+     */
+    template <typename F>
+    bool visit(const K &key, F &&f) const {
+        return this->read([&](const Map &map) {
+            auto it = map.find(key);
+            if (it == map.end()) {
+                return false;
+            }
+            std::forward<F>(f)(*it);
+            return true;
+        });
+    }
+
+    /**
+     * @brief Call f with the current snapshot. The snapshot stays valid and
+     * unchanged until f returns, whatever writers do meanwhile.
+     *
+     * @param f Called as f(const Map &).
+     * @return The result of f, by value.
+     */
+    template <typename F>
+    auto read(F &&f) const {
+        detail::EpochDomain::ReadGuard guard(detail::EpochDomain::global());
+        const Map* map = this->current_.load(std::memory_order_acquire);
+        return std::forward<F>(f)(*map);
+    }
+
+    /**
+     * @brief Modify a copy of the current snapshot and publish it, as one
+     * atomic operation.
+     *
+     * @param f Called as f(Map &).
+     * @return The result of f, by value.
+     */
+    template <typename F>
+    auto update(F &&f) {
+        std::lock_guard lock(this->writerMutex_);
+        auto next = std::make_unique<Map>(*this->current_.load(std::memory_order_relaxed));
+        if constexpr (std::is_void_v<decltype(std::forward<F>(f)(*next))>) {
+            std::forward<F>(f)(*next);
+            this->publish(std::move(next));
+        } else {
+            auto result = std::forward<F>(f)(*next);
+            this->publish(std::move(next));
+            return result;
+        }
+    }
+
+    /**
+     * @brief Insert a key-value pair if the key is not present.
+     *
+     * @return Whether the pair was inserted.
+     */
+    bool insert(std::pair<K, V> value) {
+        return this->update(
+            [&](Map &map) { return map.insert(std::move(value)).has_value(); });
+    }
+
+    /**
+     * @brief Assign a value to a key, inserting the key if it is not present.
+     *
+     * @return Whether the key was inserted.
+     */
+    template <typename M>
+    bool insert_or_assign(const K &key, M &&obj) {
+        return this->update(
+            [&](Map &map) { return map.insert_or_assign(key, std::forward<M>(obj)).second; });
+    }
+
+    /**
+     * @brief Erase a key.
+     *
+     * @return Whether the key was present and erased.
+     */
+    bool erase(const K &key) {
+        return this->update([&](Map &map) { return map.erase(key); });
+    }
+
+    size_t size() const {
+        return this->read([](const Map &map) { return map.size(); });
+    }
+
+    bool empty() const {
+        return this->size() == 0;
+    }
+
+    /**
+     * @brief Get the number of superseded snapshots not yet freed.
+     */
+    size_t retired() const {
+        std::lock_guard lock(this->writerMutex_);
+        return this->retired_.size();
+    }
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        std::unique_ptr<Map> map;
+    };
+
+    /**
+     * @brief Publish a new snapshot, retire the previous one and free every
+     * retired snapshot that no reader can still see. The writer mutex must be
+     * held.
+     */
+    void publish(std::unique_ptr<Map> next) {
+        detail::EpochDomain &domain = detail::EpochDomain::global();
+        std::unique_ptr<Map> previous(
+            this->current_.exchange(next.release(), std::memory_order_acq_rel));
+        this->retired_.push_back({domain.advance(), std::move(previous)});
+
+        uint64_t minActive = domain.minActiveEpoch();
+        auto it = this->retired_.begin();
+        while (it != this->retired_.end() && it->epoch <= minActive) {
+            ++it;
+        }
+        this->retired_.erase(this->retired_.begin(), it);
+    }
+
+    std::atomic<Map*> current_;
+    mutable std::mutex writerMutex_;
+    // Superseded snapshots in order of retirement, so also of epoch
+    std::vector<Retired> retired_;
+};
+
+} // namespace dnsge
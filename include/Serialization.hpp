@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace dnsge {
+
+/**
+ * @brief Encodes values of type T for HashMap::serialize() and decodes them for
+ * HashMap::deserialize(). Specialize for your own types, providing
+ *
+ *     template <typename Writer> static void encode(Writer &out, const T &value);
+ *     template <typename Reader> static T decode(Reader &in);
+ *
+ * where out.write(const void *data, size_t n) appends bytes and
+ * in.read(void *data, size_t n) reads exactly n bytes or throws.
+ */
+template <typename T, typename = void>
+struct Codec;
+
+/**
+ * @brief Integers, as little-endian bytes of their full width.
+ */
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_integral_v<T>>> {
+    template <typename Writer>
+    static void encode(Writer &out, T value) {
+        using U = std::make_unsigned_t<T>;
+        auto bits = static_cast<U>(value);
+        unsigned char bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bytes[i] = static_cast<unsigned char>(bits >> (8 * i));
+        }
+        out.write(bytes, sizeof(T));
+    }
+
+    template <typename Reader>
+    static T decode(Reader &in) {
+        using U = std::make_unsigned_t<T>;
+        unsigned char bytes[sizeof(T)];
+        in.read(bytes, sizeof(T));
+        U bits = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bits |= static_cast<U>(static_cast<U>(bytes[i]) << (8 * i));
+        }
+        return static_cast<T>(bits);
+    }
+};
+
+/**
+ * @brief Enumerations, as their underlying integer.
+ */
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_enum_v<T>>> {
+    using Underlying = std::underlying_type_t<T>;
+
+    template <typename Writer>
+    static void encode(Writer &out, T value) {
+        Codec<Underlying>::encode(out, static_cast<Underlying>(value));
+    }
+
+    template <typename Reader>
+    static T decode(Reader &in) {
+        return static_cast<T>(Codec<Underlying>::decode(in));
+    }
+};
+
+/**
+ * @brief Floating point numbers, as their bytes in native order.
+ */
+template <typename T>
+struct Codec<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    template <typename Writer>
+    static void encode(Writer &out, T value) {
+        out.write(&value, sizeof(T));
+    }
+
+    template <typename Reader>
+    static T decode(Reader &in) {
+        T value;
+        in.read(&value, sizeof(T));
+        return value;
+    }
+};
+
+/**
+ * @brief Strings, as a 64-bit length followed by the characters.
+ */
+template <>
+struct Codec<std::string> {
+    template <typename Writer>
+    static void encode(Writer &out, const std::string &value) {
+        Codec<uint64_t>::encode(out, value.size());
+        out.write(value.data(), value.size());
+    }
+
+    template <typename Reader>
+    static std::string decode(Reader &in) {
+        auto size = static_cast<size_t>(Codec<uint64_t>::decode(in));
+        std::string value;
+        // Grow as the characters arrive, so that a corrupt length cannot
+        // allocate more than the input holds
+        constexpr size_t ChunkSize = 4096;
+        while (value.size() < size) {
+            size_t offset = value.size();
+            value.resize(offset + std::min(ChunkSize, size - offset));
+            in.read(value.data() + offset, value.size() - offset);
+        }
+        return value;
+    }
+};
+
+template <typename A, typename B>
+struct Codec<std::pair<A, B>> {
+    template <typename Writer>
+    static void encode(Writer &out, const std::pair<A, B> &value) {
+        Codec<std::remove_const_t<A>>::encode(out, value.first);
+        Codec<B>::encode(out, value.second);
+    }
+
+    template <typename Reader>
+    static std::pair<A, B> decode(Reader &in) {
+        auto first = Codec<std::remove_const_t<A>>::decode(in);
+        return {std::move(first), Codec<B>::decode(in)};
+    }
+};
+
+/**
+ * @brief Output sink writing to a std::ostream. A sink is any object with a
+ * write(const char *data, size_t n) member that takes all n bytes.
+ */
+class StreamSink {
+public:
+    explicit StreamSink(std::ostream &out)
+        : out_(out) {}
+
+    void write(const char* data, size_t n) {
+        this->out_.write(data, static_cast<std::streamsize>(n));
+        if (!this->out_) {
+            throw std::runtime_error("failed to write to stream");
+        }
+    }
+
+private:
+    std::ostream &out_;
+};
+
+/**
+ * @brief Input source reading from a std::istream. A source is any object with
+ * a read(char *data, size_t n) member that returns how many of the n bytes it
+ * read, fewer only at the end of the input.
+ */
+class StreamSource {
+public:
+    explicit StreamSource(std::istream &in)
+        : in_(in) {}
+
+    size_t read(char* data, size_t n) {
+        this->in_.read(data, static_cast<std::streamsize>(n));
+        return static_cast<size_t>(this->in_.gcount());
+    }
+
+private:
+    std::istream &in_;
+};
+
+namespace detail {
+
+// Bytes buffered between a codec and its sink
+constexpr size_t SerializationBufferSize = 64 << 10;
+
+// Elements a deserialized HashMap reserves for before reading any
+constexpr size_t DeserializeReserveLimit = 64 << 10;
+
+/**
+ * @brief Buffers the writes of codecs into large writes to a sink.
+ */
+template <typename Sink>
+class BufferedWriter {
+public:
+    explicit BufferedWriter(Sink &sink)
+        : sink_(sink)
+        , buffer_(new char[SerializationBufferSize]) {}
+
+    void write(const void* data, size_t n) {
+        const auto* bytes = static_cast<const char*>(data);
+        if (n >= SerializationBufferSize) {
+            // Large writes bypass the buffer
+            this->flush();
+            this->sink_.write(bytes, n);
+            return;
+        }
+        if (this->used_ + n > SerializationBufferSize) {
+            this->flush();
+        }
+        std::memcpy(this->buffer_.get() + this->used_, bytes, n);
+        this->used_ += n;
+    }
+
+    void flush() {
+        if (this->used_ != 0) {
+            this->sink_.write(this->buffer_.get(), this->used_);
+            this->used_ = 0;
+        }
+    }
+
+private:
+    Sink &sink_;
+    size_t used_ = 0;
+    std::unique_ptr<char[]> buffer_;
+};
+
+/**
+ * @brief Forwards the reads of codecs to a source, never reading past the bytes
+ * they ask for so that data following a HashMap in the same input is left for
+ * the caller. Throws std::runtime_error if the source ends early.
+ */
+template <typename Source>
+class SourceReader {
+public:
+    explicit SourceReader(Source &source)
+        : source_(source) {}
+
+    void read(void* data, size_t n) {
+        if (this->source_.read(static_cast<char*>(data), n) != n) {
+            throw std::runtime_error("unexpected end of serialized HashMap");
+        }
+    }
+
+private:
+    Source &source_;
+};
+
+/**
+ * @brief Header of a serialized HashMap, followed by count encoded keys and
+ * values.
+ */
+struct SerializedHeader {
+    static constexpr char Magic[8] = {'D', 'N', 'S', 'G', 'E', 'H', 'S', '\0'};
+    static constexpr uint32_t FormatVersion = 1;
+};
+
+} // namespace detail
+
+} // namespace dnsge
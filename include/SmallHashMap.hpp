@@ -0,0 +1,628 @@
+#pragma once
+
+#include "HashMap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace dnsge {
+
+/**
+ * @brief A HashMap that keeps up to N elements inline in the object, for the
+ * many maps that stay tiny. Inline elements are kept in insertion order next to
+ * one group of control bytes, and a lookup matches the H2 of the key against
+ * every control byte at once before comparing keys. Constructing the map and
+ * filling it up to N elements allocates nothing.
+ *
+ * Inserting element N + 1 spills every element into a heap-backed HashMap, and
+ * the map keeps using it until clear(). Inserting or erasing elements
+ * invalidates every iterator.
+ */
+template <
+    typename K,
+    typename V,
+    size_t N = 8,
+    typename Hash = std::hash<K>,
+    typename Eq = std::equal_to<K>,
+    typename Policy = DefaultHashMapPolicy,
+    typename Allocator = std::allocator<std::pair<const K, V>>>
+class SmallHashMap : private detail::FunctorHolder<Hash, 0>,
+                     private detail::FunctorHolder<Eq, 1>,
+                     private detail::FunctorHolder<Allocator, 2> {
+public:
+    using Map = HashMap<K, V, Hash, Eq, Policy, Allocator>;
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = typename Map::value_type;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using allocator_type = Allocator;
+
+    static constexpr size_t InlineCapacity = N;
+
+    static_assert(N > 0 && N <= detail::Group::Width,
+                  "Inline elements must fit in one group of control bytes");
+
+    template <typename L>
+    using KeyArg = typename Map::template KeyArg<L>;
+
+    /**
+     * @brief Forward iterator over the elements of a SmallHashMap.
+     */
+    template <typename SlotType>
+    class SmallIterator {
+    private:
+        using MapIterator = std::conditional_t<std::is_const_v<SlotType>,
+                                               typename Map::const_iterator,
+                                               typename Map::iterator>;
+
+        explicit SmallIterator(SlotType* slotPtr)
+            : slotPtr_(slotPtr) {}
+
+        explicit SmallIterator(MapIterator it)
+            : it_(it)
+            , spilled_(true) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<SlotType>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = SlotType*;
+        using reference = SlotType &;
+
+        SmallIterator() = default;
+
+        /**
+         * @brief Convert an iterator to a const_iterator.
+         */
+        template <typename OtherSlot,
+                  typename = std::enable_if_t<std::is_same_v<const OtherSlot, SlotType> &&
+                                              !std::is_same_v<OtherSlot, SlotType>>>
+        SmallIterator(const SmallIterator<OtherSlot> &other)
+            : slotPtr_(other.slotPtr_)
+            , it_(other.it_)
+            , spilled_(other.spilled_) {}
+
+        SmallIterator &operator++() {
+            if (this->spilled_) {
+                ++this->it_;
+            } else {
+                ++this->slotPtr_;
+            }
+            return *this;
+        }
+
+        SmallIterator operator++(int) {
+            SmallIterator prev = *this;
+            ++*this;
+            return prev;
+        }
+
+        SlotType &operator*() const {
+            return this->spilled_ ? *this->it_ : *this->slotPtr_;
+        }
+
+        SlotType* operator->() const {
+            return &**this;
+        }
+
+        bool operator==(const SmallIterator &other) const {
+            return this->spilled_ ? this->it_ == other.it_ : this->slotPtr_ == other.slotPtr_;
+        }
+
+        bool operator!=(const SmallIterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class SmallHashMap;
+        template <typename OtherSlot>
+        friend class SmallIterator;
+        SlotType* slotPtr_ = nullptr;
+        MapIterator it_;
+        bool spilled_ = false;
+    };
+
+    using iterator = SmallIterator<value_type>;
+    using const_iterator = SmallIterator<const value_type>;
+
+    SmallHashMap()
+        : SmallHashMap(Hash()) {}
+
+    /**
+     * @brief Construct a new SmallHashMap that allocates from an allocator once
+     * it spills.
+     */
+    explicit SmallHashMap(const Allocator &alloc)
+        : SmallHashMap(Hash(), Eq(), alloc) {}
+
+    /**
+     * @brief Construct a new SmallHashMap with the function objects to hash and
+     * compare keys with, such as a SeededHash.
+     *
+     * @param hash Hash function, copied into the SmallHashMap.
+     * @param eq Key equality function, copied into the SmallHashMap.
+     * @param alloc Allocator for the HashMap the elements spill into.
+     */
+    explicit SmallHashMap(const Hash &hash,
+                          const Eq &eq = Eq(),
+                          const Allocator &alloc = Allocator())
+        : HasherHolder(hash)
+        , EqHolder(eq)
+        , AllocHolder(alloc) {
+        this->resetControl();
+    }
+
+    ~SmallHashMap() {
+        this->destroyContents();
+    }
+
+    SmallHashMap(const SmallHashMap &other)
+        : HasherHolder(other.hashRef())
+        , EqHolder(other.eqRef())
+        , AllocHolder(other.allocRef()) {
+        this->resetControl();
+        if (other.spilled_) {
+            new (&this->storage_.large) Map(other.storage_.large);
+            this->spilled_ = true;
+            return;
+        }
+        for (size_t i = 0; i < other.size_; ++i) {
+            new (&this->storage_.slots[i]) value_type(other.storage_.slots[i]);
+            this->control_[i] = other.control_[i];
+            ++this->size_;
+        }
+    }
+
+    SmallHashMap &operator=(const SmallHashMap &other) {
+        if (this != &other) {
+            SmallHashMap temp(other);
+            *this = std::move(temp);
+        }
+        return *this;
+    }
+
+    SmallHashMap(SmallHashMap &&other) noexcept(std::is_nothrow_move_constructible_v<value_type>)
+        : HasherHolder(std::move(other.hashRef()))
+        , EqHolder(std::move(other.eqRef()))
+        , AllocHolder(std::move(other.allocRef())) {
+        this->takeContents(other);
+    }
+
+    SmallHashMap &operator=(SmallHashMap &&other) noexcept(
+        std::is_nothrow_move_constructible_v<value_type>) {
+        if (this != &other) {
+            this->destroyContents();
+            this->hashRef() = std::move(other.hashRef());
+            this->eqRef() = std::move(other.eqRef());
+            this->allocRef() = std::move(other.allocRef());
+            this->takeContents(other);
+        }
+        return *this;
+    }
+
+    template <typename L = K>
+    iterator find(const KeyArg<L> &key) {
+        if (this->spilled_) {
+            return iterator(this->storage_.large.find(key));
+        }
+        auto idex = this->findInline(key, this->h2Of(key));
+        return iterator(idex ? &this->storage_.slots[*idex] : this->inlineEnd());
+    }
+
+    template <typename L = K>
+    const_iterator find(const KeyArg<L> &key) const {
+        if (this->spilled_) {
+            return const_iterator(this->storage_.large.find(key));
+        }
+        auto idex = this->findInline(key, this->h2Of(key));
+        return const_iterator(this->storage_.slots + (idex ? *idex : this->size_));
+    }
+
+    template <typename L = K>
+    bool contains(const KeyArg<L> &key) const {
+        if (this->spilled_) {
+            return this->storage_.large.contains(key);
+        }
+        return this->findInline(key, this->h2Of(key)).has_value();
+    }
+
+    /**
+     * @brief Get the value of a key. Throws std::out_of_range if the key is not
+     * present.
+     */
+    template <typename L = K>
+    V &at(const KeyArg<L> &key) {
+        auto it = this->find(key);
+        if (it == this->end()) {
+            throw std::out_of_range("key not found");
+        }
+        return it->second;
+    }
+
+    template <typename L = K>
+    const V &at(const KeyArg<L> &key) const {
+        auto it = this->find(key);
+        if (it == this->end()) {
+            throw std::out_of_range("key not found");
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief Insert a key-value pair if the key is not present. See
+     * HashMap::insert().
+     *
+     * @return Iterator or std::nullopt if already exists.
+     */
+    std::optional<iterator> insert(const std::pair<K, V> &value) {
+        auto [it, inserted] = this->tryEmplaceImpl(value.first, value.second);
+        return inserted ? std::optional<iterator>(it) : std::nullopt;
+    }
+
+    std::optional<iterator> insert(std::pair<K, V> &&value) {
+        auto [it, inserted] = this->tryEmplaceImpl(std::move(value.first), std::move(value.second));
+        return inserted ? std::optional<iterator>(it) : std::nullopt;
+    }
+
+    /**
+     * @brief Insert a value constructed in place from args if the key is not
+     * present. Nothing is constructed, and the key is not moved from, if the key
+     * already exists.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K &key, Args &&...args) {
+        return this->tryEmplaceImpl(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+        return this->tryEmplaceImpl(std::move(key), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Insert a key-value pair, or assign the value if the key already exists.
+     */
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const K &key, M &&obj) {
+        return this->insertOrAssignImpl(key, std::forward<M>(obj));
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(K &&key, M &&obj) {
+        return this->insertOrAssignImpl(std::move(key), std::forward<M>(obj));
+    }
+
+    template <typename U = V>
+    typename std::enable_if_t<std::is_default_constructible_v<U>, V &> operator[](const K &key) {
+        return this->tryEmplaceImpl(key).first->second;
+    }
+
+    template <typename U = V>
+    typename std::enable_if_t<std::is_default_constructible_v<U>, V &> operator[](K &&key) {
+        return this->tryEmplaceImpl(std::move(key)).first->second;
+    }
+
+    /**
+     * @brief Erase a key.
+     *
+     * @return Whether the key was present and erased.
+     */
+    template <typename L = K>
+    bool erase(const KeyArg<L> &key) {
+        return this->erase(this->find(key));
+    }
+
+    /**
+     * @brief Erase the element at an iterator.
+     *
+     * @return Whether the iterator pointed to an element.
+     */
+    bool erase(iterator it) {
+        if (this->spilled_) {
+            return this->storage_.large.erase(it.it_);
+        }
+        if (it.slotPtr_ == this->inlineEnd()) {
+            return false;
+        }
+        this->eraseInline(static_cast<size_t>(it.slotPtr_ - this->storage_.slots));
+        return true;
+    }
+
+    /**
+     * @brief Erase every element that satisfies a predicate, in one sweep.
+     *
+     * @param pred Called as pred(const value_type &) for every element.
+     * @return Number of elements erased.
+     */
+    template <typename Pred>
+    size_t erase_if(Pred &&pred) {
+        if (this->spilled_) {
+            return this->storage_.large.erase_if(std::forward<Pred>(pred));
+        }
+        size_t erased = 0;
+        size_t i = 0;
+        while (i < this->size_) {
+            if (pred(static_cast<const value_type &>(this->storage_.slots[i]))) {
+                // The last element moves into slot i, so check it next
+                this->eraseInline(i);
+                ++erased;
+            } else {
+                ++i;
+            }
+        }
+        return erased;
+    }
+
+    /**
+     * @brief Erase every element. Frees the HashMap the elements spilled into,
+     * if any, so that the map is inline again.
+     */
+    void clear() {
+        this->destroyContents();
+        this->resetControl();
+    }
+
+    /**
+     * @brief Make room for n elements, spilling to a HashMap if n exceeds the
+     * inline capacity.
+     */
+    void reserve(size_t n) {
+        if (!this->spilled_ && n > N) {
+            this->spill();
+        }
+        if (this->spilled_) {
+            this->storage_.large.reserve(n);
+        }
+    }
+
+    size_t size() const {
+        return this->spilled_ ? this->storage_.large.size() : this->size_;
+    }
+
+    bool empty() const {
+        return this->size() == 0;
+    }
+
+    /**
+     * @brief Check whether the elements are still stored inline.
+     */
+    bool is_inline() const {
+        return !this->spilled_;
+    }
+
+    iterator begin() {
+        if (this->spilled_) {
+            return iterator(this->storage_.large.begin());
+        }
+        return iterator(this->storage_.slots);
+    }
+
+    iterator end() {
+        if (this->spilled_) {
+            return iterator(this->storage_.large.end());
+        }
+        return iterator(this->inlineEnd());
+    }
+
+    const_iterator begin() const {
+        if (this->spilled_) {
+            return const_iterator(this->storage_.large.begin());
+        }
+        return const_iterator(this->storage_.slots);
+    }
+
+    const_iterator end() const {
+        if (this->spilled_) {
+            return const_iterator(this->storage_.large.end());
+        }
+        return const_iterator(this->storage_.slots + this->size_);
+    }
+
+    const_iterator cbegin() const {
+        return this->begin();
+    }
+
+    const_iterator cend() const {
+        return this->end();
+    }
+
+    hasher hash_function() const {
+        return this->hashRef();
+    }
+
+    key_equal key_eq() const {
+        return this->eqRef();
+    }
+
+    allocator_type get_allocator() const {
+        return this->allocRef();
+    }
+
+private:
+    using HasherHolder = detail::FunctorHolder<Hash, 0>;
+    using EqHolder = detail::FunctorHolder<Eq, 1>;
+    using AllocHolder = detail::FunctorHolder<Allocator, 2>;
+
+    /**
+     * @brief Inline elements or the HashMap they spilled into, whichever is in
+     * use. Neither is constructed by the union itself.
+     */
+    union Storage {
+        Storage() {}
+        ~Storage() {}
+
+        value_type slots[N];
+        Map large;
+    };
+
+    Hash &hashRef() {
+        return this->HasherHolder::get();
+    }
+
+    const Hash &hashRef() const {
+        return this->HasherHolder::get();
+    }
+
+    Eq &eqRef() {
+        return this->EqHolder::get();
+    }
+
+    const Eq &eqRef() const {
+        return this->EqHolder::get();
+    }
+
+    Allocator &allocRef() {
+        return this->AllocHolder::get();
+    }
+
+    const Allocator &allocRef() const {
+        return this->AllocHolder::get();
+    }
+
+    value_type* inlineEnd() {
+        return this->storage_.slots + this->size_;
+    }
+
+    template <typename L>
+    detail::metadata_t h2Of(const L &key) const {
+        return detail::H2(detail::MixHash<Hash>(this->hashRef()(key)));
+    }
+
+    /**
+     * @brief Find a key among the inline elements. Control bytes past the last
+     * element are Empty, which no H2 matches.
+     */
+    template <typename L>
+    std::optional<size_t> findInline(const L &key, detail::metadata_t h2) const {
+        detail::Group group(this->control_);
+        for (uint32_t i : group.match(h2)) {
+            if (this->eqRef()(key, this->storage_.slots[i].first)) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    template <typename KArg, typename... Args>
+    std::pair<iterator, bool> tryEmplaceImpl(KArg &&key, Args &&...args) {
+        if (!this->spilled_) {
+            auto h2 = this->h2Of(key);
+            if (auto idex = this->findInline(key, h2)) {
+                return {iterator(&this->storage_.slots[*idex]), false};
+            }
+            if (this->size_ < N) {
+                value_type* slot = this->inlineEnd();
+                new (slot) value_type(std::piecewise_construct,
+                                      std::forward_as_tuple(std::forward<KArg>(key)),
+                                      std::forward_as_tuple(std::forward<Args>(args)...));
+                this->control_[this->size_] = h2;
+                ++this->size_;
+                return {iterator(slot), true};
+            }
+            this->spill();
+        }
+        auto [it, inserted] = this->storage_.large.try_emplace(std::forward<KArg>(key),
+                                                               std::forward<Args>(args)...);
+        return {iterator(it), inserted};
+    }
+
+    template <typename KArg, typename M>
+    std::pair<iterator, bool> insertOrAssignImpl(KArg &&key, M &&obj) {
+        auto res = this->tryEmplaceImpl(std::forward<KArg>(key), std::forward<M>(obj));
+        if (!res.second) {
+            // Nothing was moved from, since the key was already present
+            res.first->second = std::forward<M>(obj);
+        }
+        return res;
+    }
+
+    /**
+     * @brief Destroy an inline element and fill its place with the last one,
+     * keeping the inline elements contiguous.
+     */
+    void eraseInline(size_t idex) {
+        size_t last = this->size_ - 1;
+        this->storage_.slots[idex].~value_type();
+        if (idex != last) {
+            new (&this->storage_.slots[idex]) value_type(std::move(this->storage_.slots[last]));
+            this->storage_.slots[last].~value_type();
+            this->control_[idex] = this->control_[last];
+        }
+        this->control_[last] = detail::Metadata::Empty;
+        --this->size_;
+    }
+
+    /**
+     * @brief Move the inline elements into a HashMap and use it from now on.
+     */
+    void spill() {
+        assert(!this->spilled_);
+        Map large(Map::DefaultInitialCapacity, this->hashRef(), this->eqRef(), this->allocRef());
+        for (size_t i = 0; i < this->size_; ++i) {
+            value_type &slot = this->storage_.slots[i];
+            large.try_emplace(slot.first, std::move(slot.second));
+        }
+        this->destroyContents();
+        this->resetControl();
+        new (&this->storage_.large) Map(std::move(large));
+        this->spilled_ = true;
+    }
+
+    /**
+     * @brief Take the elements of another SmallHashMap, which holds none
+     * afterwards. Ours must already be destroyed.
+     */
+    void takeContents(SmallHashMap &other) {
+        this->resetControl();
+        if (other.spilled_) {
+            new (&this->storage_.large) Map(std::move(other.storage_.large));
+            this->spilled_ = true;
+        } else {
+            for (size_t i = 0; i < other.size_; ++i) {
+                new (&this->storage_.slots[i]) value_type(std::move(other.storage_.slots[i]));
+                this->control_[i] = other.control_[i];
+                ++this->size_;
+            }
+        }
+        other.clear();
+    }
+
+    /**
+     * @brief Destroy the elements, leaving the storage unused.
+     */
+    void destroyContents() {
+        if (this->spilled_) {
+            this->storage_.large.~Map();
+            this->spilled_ = false;
+        } else {
+            for (size_t i = 0; i < this->size_; ++i) {
+                this->storage_.slots[i].~value_type();
+            }
+        }
+        this->size_ = 0;
+    }
+
+    void resetControl() {
+        std::fill(std::begin(this->control_), std::end(this->control_), detail::Metadata::Empty);
+    }
+
+    Storage storage_;
+    // H2 of each inline element, then Empty up to the width of a group
+    detail::metadata_t control_[detail::Group::Width];
+    // Number of inline elements
+    size_t size_ = 0;
+    bool spilled_ = false;
+};
+
+} // namespace dnsge
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace dnsge {
+
+namespace detail {
+
+/**
+ * @brief Unit of allocation for TableStorage. Keeps every block at least as
+ * aligned as std::max_align_t, whatever byte alignment the allocator provides.
+ */
+struct alignas(std::max_align_t) StorageBlock {
+    unsigned char bytes[alignof(std::max_align_t)];
+};
+
+constexpr size_t AlignUp(size_t n, size_t alignment) {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr bool IsPowerOfTwo(size_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+} // namespace detail
+
+/**
+ * @brief A single allocation holding a byte array followed by a fixed-length,
+ * uninitialized array of T. Elements are not initialized nor destructed
+ * automatically -- users must take care to keep track of which elements need
+ * to be destructed. The bytes are not initialized either.
+ *
+ * The block and the T array both start at a multiple of the requested alignment
+ * (at least alignof(T)). Alignments stricter than std::max_align_t are met by
+ * over-allocating and aligning within the block.
+ *
+ * @tparam T
+ * @tparam Allocator
+ */
+template <typename T, typename Allocator = std::allocator<T>>
+class TableStorage
+    : private std::allocator_traits<Allocator>::template rebind_alloc<detail::StorageBlock> {
+public:
+    using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+private:
+    using BlockAlloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<detail::StorageBlock>;
+    using BlockAllocTraits = std::allocator_traits<BlockAlloc>;
+
+    static_assert(std::is_same_v<typename BlockAllocTraits::pointer, detail::StorageBlock*>,
+                  "Allocator must use raw pointers");
+
+public:
+    /**
+     * @brief Allocate storage for numBytes bytes followed by size elements.
+     *
+     * @param numBytes Length of the leading byte array.
+     * @param size Number of elements.
+     * @param alignment Alignment of the block and of the elements. Must be a
+     * power of two; raised to alignof(T) if smaller.
+     * @param alloc Allocator for the block.
+     */
+    TableStorage(size_t numBytes,
+                 size_t size,
+                 size_t alignment,
+                 const allocator_type &alloc = allocator_type())
+        : BlockAlloc(alloc)
+        , numBytes_(numBytes)
+        , size_(size) {
+        assert(detail::IsPowerOfTwo(alignment));
+        alignment = std::max(alignment, alignof(T));
+        this->offset_ = detail::AlignUp(numBytes, alignment);
+        size_t bytes = this->offset_ + size * sizeof(T);
+        size_t slack = alignment > alignof(detail::StorageBlock)
+                           ? alignment - alignof(detail::StorageBlock)
+                           : 0;
+        this->numBlocks_ = (bytes + slack + sizeof(detail::StorageBlock) - 1) /
+                           sizeof(detail::StorageBlock);
+        this->blocks_ = BlockAllocTraits::allocate(this->alloc(), this->numBlocks_);
+        assert(this->blocks_ != nullptr);
+        auto base = reinterpret_cast<uintptr_t>(this->blocks_);
+        this->data_ = reinterpret_cast<unsigned char*>(detail::AlignUp(base, alignment));
+    }
+
+    ~TableStorage() {
+        this->deallocate();
+    }
+
+    TableStorage(const TableStorage &other) = delete;
+    TableStorage &operator=(const TableStorage &other) = delete;
+
+    TableStorage(TableStorage &&other) noexcept
+        : BlockAlloc(std::move(other.alloc()))
+        , numBytes_(other.numBytes_)
+        , size_(other.size_)
+        , offset_(other.offset_)
+        , numBlocks_(other.numBlocks_)
+        , blocks_(other.blocks_)
+        , data_(other.data_) {
+        other.release();
+    }
+
+    /**
+     * @brief Take over the storage of another TableStorage. The allocators must
+     * be equal or propagate on move assignment.
+     */
+    TableStorage &operator=(TableStorage &&other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        this->deallocate();
+        if constexpr (BlockAllocTraits::propagate_on_container_move_assignment::value) {
+            this->alloc() = std::move(other.alloc());
+        }
+        assert(this->alloc() == other.alloc());
+        this->numBytes_ = other.numBytes_;
+        this->size_ = other.size_;
+        this->offset_ = other.offset_;
+        this->numBlocks_ = other.numBlocks_;
+        this->blocks_ = other.blocks_;
+        this->data_ = other.data_;
+        other.release();
+        return *this;
+    }
+
+    unsigned char* bytes() {
+        return this->data_;
+    }
+
+    const unsigned char* bytes() const {
+        return this->data_;
+    }
+
+    T* data() {
+        return reinterpret_cast<T*>(this->data_ + this->offset_);
+    }
+
+    const T* data() const {
+        return reinterpret_cast<const T*>(this->data_ + this->offset_);
+    }
+
+    T &operator[](size_t n) {
+        assert(n < this->size_);
+        return this->data()[n];
+    }
+
+    const T &operator[](size_t n) const {
+        assert(n < this->size_);
+        return this->data()[n];
+    }
+
+    size_t numBytes() const {
+        return this->numBytes_;
+    }
+
+    size_t size() const {
+        return this->size_;
+    }
+
+    /**
+     * @brief Get the number of bytes obtained from the allocator, including
+     * alignment slack.
+     */
+    size_t allocatedBytes() const {
+        return this->numBlocks_ * sizeof(detail::StorageBlock);
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(this->alloc());
+    }
+
+private:
+    BlockAlloc &alloc() {
+        return *this;
+    }
+
+    const BlockAlloc &alloc() const {
+        return *this;
+    }
+
+    void deallocate() {
+        if (this->blocks_ != nullptr) {
+            BlockAllocTraits::deallocate(this->alloc(), this->blocks_, this->numBlocks_);
+        }
+        this->release();
+    }
+
+    void release() {
+        this->numBytes_ = 0;
+        this->size_ = 0;
+        this->offset_ = 0;
+        this->numBlocks_ = 0;
+        this->blocks_ = nullptr;
+        this->data_ = nullptr;
+    }
+
+    size_t numBytes_;
+    size_t size_;
+    // Offset of the element array from the start of the aligned block
+    size_t offset_ = 0;
+    size_t numBlocks_ = 0;
+    detail::StorageBlock* blocks_ = nullptr;
+    unsigned char* data_ = nullptr;
+};
+
+} // namespace dnsge
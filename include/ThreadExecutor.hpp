@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace dnsge {
+
+/**
+ * @brief Executor that runs a batch of tasks on short-lived std::threads. An
+ * executor is any object callable as executor(numTasks, task) that calls
+ * task(i) once for every i in [0, numTasks), possibly concurrently, and returns
+ * once every call has returned.
+ *
+ * The calling thread runs tasks too. If a task throws, the remaining tasks are
+ * skipped and the first exception is rethrown once every thread is joined.
+ */
+class ThreadExecutor {
+public:
+    /**
+     * @brief Construct a new ThreadExecutor.
+     *
+     * @param threads Maximum number of threads to run tasks on, including the
+     * calling thread. 0 uses one per hardware thread.
+     */
+    explicit ThreadExecutor(size_t threads = 0)
+        : threads_(threads != 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u)) {}
+
+    template <typename F>
+    void operator()(size_t numTasks, F &&task) const {
+        size_t numThreads = std::min(this->threads_, numTasks);
+        if (numThreads <= 1) {
+            for (size_t i = 0; i < numTasks; ++i) {
+                task(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto work = [&] {
+            size_t i;
+            while (!failed.load(std::memory_order_relaxed) &&
+                   (i = next.fetch_add(1, std::memory_order_relaxed)) < numTasks) {
+                try {
+                    task(i);
+                } catch (...) {
+                    std::lock_guard lock(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads - 1);
+        for (size_t t = 1; t < numThreads; ++t) {
+            try {
+                threads.emplace_back(work);
+            } catch (const std::system_error &) {
+                // Run the remaining tasks on the threads already started
+                break;
+            }
+        }
+        work();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    size_t threads() const {
+        return this->threads_;
+    }
+
+private:
+    size_t threads_;
+};
+
+} // namespace dnsge
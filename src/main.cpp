@@ -1,9 +1,29 @@
+#include "ConcurrentHashMap.hpp"
+#include "Hash.hpp"
 #include "HashMap.hpp"
+#include "HashSet.hpp"
+#include "MappedHashMap.hpp"
+#include "ReadMostlyHashMap.hpp"
+#include "SmallHashMap.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -126,6 +146,75 @@ TEST(HashMap, EraseIterator) {
     ASSERT_FALSE(deleted);
 }
 
+TEST(HashMap, EraseIf) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, StatsHashMapPolicy<>>;
+    Map map;
+    for (int i = 0; i < 10000; ++i) {
+        map.insert({i, i});
+    }
+    size_t capacity = map.capacity();
+    auto before = map.stats();
+    ASSERT_EQ(map.erase_if([](const auto &slot) { return slot.second % 3 != 0; }), 6666UL);
+    ASSERT_EQ(map.size(), 3334UL);
+    ASSERT_EQ(map.capacity(), capacity);
+    ASSERT_EQ(map.stats().rehashes, before.rehashes);
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(map.contains(i), i % 3 == 0);
+    }
+
+    // Ranges are erased in one sweep too
+    auto first = map.begin();
+    auto last = first;
+    std::advance(last, 1000);
+    ASSERT_EQ(map.erase(first, last), 1000UL);
+    ASSERT_EQ(map.size(), 2334UL);
+    ASSERT_EQ(map.erase(map.begin(), map.end()), 2334UL);
+    ASSERT_TRUE(map.empty());
+
+    // Sweeping during an incremental resize visits both tables once
+    HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> growing(16);
+    for (int i = 0; i < 1000; ++i) {
+        growing.insert({i, i});
+    }
+    size_t visited = 0;
+    growing.erase_if([&](const auto &slot) {
+        ++visited;
+        return slot.first % 2 == 0;
+    });
+    ASSERT_EQ(visited, 1000UL);
+    ASSERT_EQ(growing.size(), 500UL);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(growing.contains(i), i % 2 == 1);
+    }
+
+    // Shrinking maps shrink once, after the sweep
+    using ShrinkingPolicy = ShrinkingHashMapPolicy<StatsHashMapPolicy<>>;
+    HashMap<int, int, IntHasher, std::equal_to<int>, ShrinkingPolicy> shrinking;
+    for (int i = 0; i < 10000; ++i) {
+        shrinking.insert({i, i});
+    }
+    shrinking.erase_if([](const auto &slot) { return slot.first >= 10; });
+    ASSERT_EQ(shrinking.stats().shrinks, 1UL);
+    ASSERT_LT(shrinking.capacity(), 100UL);
+
+    HashSet<int, IntHasher> set;
+    for (int i = 0; i < 100; ++i) {
+        set.insert(i);
+    }
+    ASSERT_EQ(set.erase_if([](int key) { return key < 90; }), 90UL);
+    ASSERT_EQ(set.size(), 10UL);
+
+    SmallHashMap<int, int, 8, IntHasher> small;
+    for (int i = 0; i < 8; ++i) {
+        small.insert({i, i});
+    }
+    ASSERT_EQ(small.erase_if([](const auto &slot) { return slot.first >= 4; }), 4UL);
+    ASSERT_TRUE(small.is_inline());
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_EQ(small.contains(i), i < 4);
+    }
+}
+
 TEST(HashMap, Copy) {
     HashMap<int, std::string, IntHasher> map1;
     map1.insert({1, "abc"});
@@ -362,6 +451,68 @@ TEST(HashMap, MoveCount) {
     ASSERT_EQ(moveCount, 1UL);         // should have moved the one element
 }
 
+struct RelocatableMover {
+    static inline size_t moveCount = 0;
+
+    explicit RelocatableMover(int value)
+        : value(value) {}
+
+    RelocatableMover(RelocatableMover &&other) noexcept
+        : value(other.value) {
+        ++moveCount;
+    }
+
+    int value;
+};
+
+namespace dnsge {
+template <>
+struct IsTriviallyRelocatable<RelocatableMover> : std::true_type {};
+} // namespace dnsge
+
+TEST(HashMap, TriviallyRelocatable) {
+    static_assert(IsTriviallyRelocatable<std::pair<const int, double>>::value);
+    static_assert(!IsTriviallyRelocatable<std::pair<const int, std::string>>::value);
+
+    // Growing and rehashing relocate elements without moving them
+    HashMap<int, RelocatableMover, IntHasher> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.try_emplace(i, i);
+    }
+    map.reserve(10000);
+    for (int i = 0; i < 5000; ++i) {
+        map.erase(i);
+        map.try_emplace(i + 1000, i + 1000);
+    }
+    ASSERT_EQ(RelocatableMover::moveCount, 0UL);
+    for (int i = 5000; i < 6000; ++i) {
+        ASSERT_EQ(map.at(i).value, i);
+    }
+
+    HashMap<int, std::unique_ptr<int>, IntHasher> owners;
+    for (int i = 0; i < 1000; ++i) {
+        owners.try_emplace(i, std::make_unique<int>(i));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(*owners.at(i), i);
+    }
+
+    // Copies of trivially copyable slots copy the slot array in bulk
+    HashMap<int, int, IntHasher> pods;
+    for (int i = 0; i < 1000; ++i) {
+        pods.insert({i, -i});
+    }
+    for (int i = 0; i < 1000; i += 3) {
+        pods.erase(i);
+    }
+    auto copy = pods;
+    ASSERT_EQ(copy.size(), pods.size());
+    for (const auto &[key, value] : pods) {
+        ASSERT_EQ(copy.at(key), value);
+    }
+    ASSERT_FALSE(copy.contains(0));
+}
+
 TEST(HashMap, InsertionSemantics) {
     HashMap<int, std::string, IntHasher> map;
     std::pair<int, std::string> keyValue1{5, "Hello"};
@@ -411,6 +562,1816 @@ TEST(HashMap, InsertionCollision) {
     ASSERT_TRUE(map.contains(21));
 }
 
+TEST(HashMap, InsertionCollisionAfterErase) {
+    struct ConstantHasher {
+        size_t operator()(int /*x*/) const {
+            return 0;
+        }
+    };
+
+    HashMap<int, std::string, ConstantHasher> map;
+
+    map.insert({1, "one"});
+    map.insert({2, "two"});
+    map.erase(1);
+
+    // Key 2 lies past the deleted slot and must not be inserted twice
+    ASSERT_FALSE(map.insert({2, "again"}).has_value());
+    ASSERT_EQ(map.size(), 1UL);
+    ASSERT_EQ(map.find(2)->second, "two");
+}
+
+TEST(HashMap, ProbeWrapsAround) {
+    struct LastSlotHasher {
+        size_t operator()(int x) const {
+            // Every key starts probing at slot 63, the last slot of the table
+            return (63UL << 7) | static_cast<size_t>(x % 2);
+        }
+    };
+
+    HashMap<int, int, LastSlotHasher> map(64);
+
+    for (int i = 0; i < 40; ++i) {
+        map.insert({i, i * 2});
+    }
+    ASSERT_EQ(map.capacity(), 64UL);
+    for (int i = 0; i < 40; ++i) {
+        ASSERT_NE(map.find(i), map.end());
+        ASSERT_EQ(map.find(i)->second, i * 2);
+    }
+    ASSERT_FALSE(map.contains(40));
+
+    for (int i = 0; i < 40; i += 3) {
+        ASSERT_TRUE(map.erase(i));
+    }
+    for (int i = 0; i < 40; ++i) {
+        ASSERT_EQ(map.contains(i), i % 3 != 0);
+    }
+}
+
+TEST(HashMap, PowerOfTwoCapacity) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, PowerOfTwoHashMapPolicy>;
+
+    Map map(20);
+    ASSERT_EQ(map.capacity(), 31UL);
+
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, -i});
+    }
+    ASSERT_EQ(map.size(), 1000UL);
+    ASSERT_EQ((map.capacity() + 1) & map.capacity(), 0UL);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(map.at(i), -i);
+    }
+    ASSERT_FALSE(map.contains(1000));
+
+    map.reserve(5000);
+    ASSERT_GE(map.capacity(), 5000UL);
+    ASSERT_EQ((map.capacity() + 1) & map.capacity(), 0UL);
+    ASSERT_EQ(map.at(999), -999);
+}
+
+TEST(ProbeSeq, TriangularVisitsEveryGroup) {
+    for (size_t capacity : {15UL, 63UL, 1023UL}) {
+        size_t groups = (capacity + 1) / detail::Group::Width;
+        if (groups == 0) {
+            continue;
+        }
+        std::vector<bool> seen(capacity + 1, false);
+        detail::ProbeSeq<true> seq(5, capacity);
+        for (size_t i = 0; i < groups; ++i) {
+            for (size_t j = 0; j < detail::Group::Width; ++j) {
+                seen[seq.offset(j)] = true;
+            }
+            seq.next();
+        }
+        for (bool s : seen) {
+            ASSERT_TRUE(s);
+        }
+    }
+}
+
+TEST(HashMap, EraseChurnRehashesInPlace) {
+    HashMap<int, std::string, IntHasher> map(64);
+
+    // Keep 40 live keys while cycling through many more, so that tombstones
+    // repeatedly trigger a rehash at the same capacity
+    for (int i = 0; i < 40; ++i) {
+        map.insert({i, std::to_string(i)});
+    }
+    for (int i = 40; i < 2000; ++i) {
+        ASSERT_TRUE(map.erase(i - 40));
+        map.insert({i, std::to_string(i)});
+        ASSERT_EQ(map.size(), 40UL);
+    }
+    ASSERT_EQ(map.capacity(), 64UL);
+
+    for (int i = 0; i < 1960; ++i) {
+        ASSERT_FALSE(map.contains(i));
+    }
+    for (int i = 1960; i < 2000; ++i) {
+        ASSERT_EQ(map.at(i), std::to_string(i));
+    }
+}
+
+TEST(HashMap, EraseChurnWithCollisions) {
+    struct FewBucketsHasher {
+        size_t operator()(int x) const {
+            return static_cast<size_t>(x % 4) << 7 | static_cast<size_t>(x % 3);
+        }
+    };
+
+    HashMap<int, std::string, FewBucketsHasher> map(32);
+    for (int i = 0; i < 20; ++i) {
+        map.insert({i, std::to_string(i)});
+    }
+    for (int i = 20; i < 500; ++i) {
+        ASSERT_TRUE(map.erase(i - 20));
+        map.insert({i, std::to_string(i)});
+    }
+    ASSERT_EQ(map.capacity(), 32UL);
+    ASSERT_EQ(map.size(), 20UL);
+    for (int i = 480; i < 500; ++i) {
+        ASSERT_EQ(map.at(i), std::to_string(i));
+    }
+    ASSERT_FALSE(map.contains(479));
+}
+
+struct DensePolicy : DefaultHashMapPolicy {
+    static constexpr float MaxLoadFactor = 0.9375f;
+    static constexpr float GrowthFactor = 1.5f;
+};
+
+// Sets the knob replaced by MinDeletedRehashFraction, which HashMap rejects
+struct LegacyDeletedPolicy : DefaultHashMapPolicy {
+    static constexpr float MaxDeletedLoadFactor = 0.875f;
+};
+
+TEST(HashMap, EraseWithoutTombstones) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, StatsHashMapPolicy<>>;
+
+    // A sparse table rarely needs a tombstone. Churn through tombstones alone
+    // would rehash every 800 erasures or so.
+    Map sparse(1024);
+    for (int i = 0; i < 100000; ++i) {
+        sparse.insert({i, i});
+        if (i >= 100) {
+            ASSERT_TRUE(sparse.erase(i - 100));
+        }
+    }
+    ASSERT_LT(sparse.stats().rehashes, 5UL);
+    ASSERT_EQ(sparse.capacity(), 1024UL);
+
+    // Near the max load factor some erasures still leave tombstones, and
+    // lookups stay correct across both kinds of erasure
+    struct FewBucketsHasher {
+        size_t operator()(int x) const {
+            return static_cast<size_t>(x % 7) << 7 | static_cast<size_t>(x % 5);
+        }
+    };
+    HashMap<int, int, FewBucketsHasher> dense(64);
+    std::unordered_map<int, int> expected;
+    for (int i = 0; i < 5000; ++i) {
+        dense.insert({i, i});
+        expected.emplace(i, i);
+        int victim = (i * 7919) % (i + 1);
+        ASSERT_EQ(dense.erase(victim), expected.erase(victim) == 1);
+        ASSERT_EQ(dense.size(), expected.size());
+    }
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT_EQ(dense.contains(i), expected.count(i) == 1);
+    }
+}
+
+TEST(HashMap, TunableLoadFactor) {
+    using DenseMap = HashMap<int, int, IntHasher, std::equal_to<int>, DensePolicy>;
+    static_assert(DenseMap::MaxLoadFactor == 0.9375f);
+    static_assert(detail::SetsMaxDeletedLoadFactor<LegacyDeletedPolicy>::value);
+    static_assert(!detail::SetsMaxDeletedLoadFactor<DensePolicy>::value);
+
+    DenseMap dense(64);
+    ASSERT_EQ(dense.max_load_factor(), 0.9375f);
+    for (int i = 0; i < 60; ++i) {
+        dense.insert({i, i});
+    }
+    ASSERT_EQ(dense.capacity(), 64UL);
+    dense.insert({60, 60});
+    ASSERT_EQ(dense.capacity(), 96UL);
+
+    // Runtime overrides take precedence over the policy, and survive copies
+    HashMap<int, int, IntHasher> sparse(64);
+    sparse.max_load_factor(0.5f);
+    sparse.growth_factor(4);
+    for (int i = 0; i < 32; ++i) {
+        sparse.insert({i, i});
+    }
+    ASSERT_EQ(sparse.capacity(), 64UL);
+    sparse.insert({32, 32});
+    ASSERT_EQ(sparse.capacity(), 256UL);
+    auto copy = sparse;
+    ASSERT_EQ(copy.max_load_factor(), 0.5f);
+    ASSERT_EQ(copy.growth_factor(), 4.0f);
+
+    // Lowering the max load factor grows a table that no longer fits
+    copy.max_load_factor(0.125f);
+    ASSERT_LE(copy.load_factor(), 0.125f);
+    for (int i = 0; i < 33; ++i) {
+        ASSERT_EQ(copy.at(i), i);
+    }
+
+    sparse.reserve(1000);
+    ASSERT_GE(sparse.capacity() / 2, 1000UL);
+
+    ASSERT_THROW(sparse.max_load_factor(0), std::invalid_argument);
+    ASSERT_THROW(sparse.max_load_factor(1.5f), std::invalid_argument);
+    ASSERT_THROW(sparse.growth_factor(1), std::invalid_argument);
+    ASSERT_THROW(sparse.min_deleted_rehash_fraction(-1), std::invalid_argument);
+}
+
+TEST(HashMap, DeletedFractionPicksRehashOrGrow) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, StatsHashMapPolicy<>>;
+
+    // Erase churn at a steady, dense size rehashes in place
+    Map churn(64);
+    for (int i = 0; i < 2000; ++i) {
+        churn.insert({i, i});
+        if (i >= 48) {
+            churn.erase(i - 48);
+        }
+    }
+    ASSERT_EQ(churn.capacity(), 64UL);
+    ASSERT_GT(churn.stats().rehashes, 0UL);
+
+    // A table only allowed to rehash once its used slots are all deleted grows instead
+    Map grows(64);
+    grows.min_deleted_rehash_fraction(1);
+    for (int i = 0; i < 200; ++i) {
+        grows.insert({i, i});
+        if (i >= 48) {
+            grows.erase(i - 48);
+        }
+    }
+    ASSERT_GT(grows.capacity(), 64UL);
+    ASSERT_EQ(grows.stats().rehashes, 0UL);
+    ASSERT_EQ(grows.size(), 48UL);
+}
+
+TEST(HashMap, ShrinkToFit) {
+    HashMap<int, std::string, IntHasher> map;
+    for (int i = 0; i < 10000; ++i) {
+        map.insert({i, std::to_string(i)});
+    }
+    size_t fullBytes = map.stats().bytesAllocated;
+    for (int i = 0; i < 9500; ++i) {
+        map.erase(i);
+    }
+    ASSERT_GT(map.capacity(), 10000UL);
+
+    map.shrink_to_fit();
+    ASSERT_LT(map.capacity(), 1000UL);
+    ASSERT_GE(map.capacity() * map.max_load_factor(), 500.0f);
+    ASSERT_EQ(map.stats().deletedCount, 0UL);
+    ASSERT_LT(map.stats().bytesAllocated * 10, fullBytes);
+    for (int i = 9500; i < 10000; ++i) {
+        ASSERT_EQ(map.at(i), std::to_string(i));
+    }
+
+    // rehash() grows as well, but never below what the elements need
+    map.rehash(4000);
+    ASSERT_GE(map.capacity(), 4000UL);
+    map.rehash(1);
+    ASSERT_LT(map.capacity(), 1000UL);
+    ASSERT_EQ(map.size(), 500UL);
+
+    map.clear();
+    map.shrink_to_fit();
+    ASSERT_EQ(map.capacity(), 0UL);
+    map.insert({1, "1"});
+    ASSERT_EQ(map.at(1), "1");
+}
+
+TEST(HashMap, ShrinkAutomatically) {
+    using Policy = ShrinkingHashMapPolicy<StatsHashMapPolicy<>>;
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, Policy>;
+
+    Map map;
+    for (int i = 0; i < 10000; ++i) {
+        map.insert({i, i});
+    }
+    size_t fullCapacity = map.capacity();
+    for (int i = 0; i < 9900; ++i) {
+        map.erase(i);
+    }
+    ASSERT_LT(map.capacity() * 20, fullCapacity);
+    ASSERT_GT(map.stats().shrinks, 0UL);
+    // Shrinks land at half the max load factor, so they stay rare
+    ASSERT_LT(map.stats().shrinks, 10UL);
+    for (int i = 9900; i < 10000; ++i) {
+        ASSERT_EQ(map.at(i), i);
+    }
+
+    // Churn at a steady size does not shrink and grow back and forth
+    uint64_t shrinks = map.stats().shrinks;
+    uint64_t grows = map.stats().grows;
+    for (int i = 10000; i < 20000; ++i) {
+        map.insert({i, i});
+        map.erase(i - 100);
+    }
+    ASSERT_EQ(map.stats().shrinks, shrinks);
+    ASSERT_EQ(map.stats().grows, grows);
+
+    map.clear();
+    ASSERT_LE(map.capacity(), Map::DefaultInitialCapacity);
+
+    // Shrinking can be turned on at runtime
+    HashMap<int, int, IntHasher> plain;
+    plain.shrink_load_factor(0.1f);
+    for (int i = 0; i < 1000; ++i) {
+        plain.insert({i, i});
+    }
+    for (int i = 0; i < 990; ++i) {
+        plain.erase(i);
+    }
+    ASSERT_LT(plain.capacity(), 200UL);
+
+    // The smallest power of two table has nothing to shrink to
+    using PowerOfTwoPolicy = ShrinkingHashMapPolicy<StatsHashMapPolicy<PowerOfTwoHashMapPolicy>>;
+    HashMap<int, int, IntHasher, std::equal_to<int>, PowerOfTwoPolicy> smallest;
+    size_t smallestCapacity = smallest.capacity();
+    ASSERT_GT(smallestCapacity, Map::DefaultInitialCapacity);
+    // Fill every group, so that erasures leave deleted slots behind
+    int fill = static_cast<int>(smallestCapacity * Map::MaxLoadFactor);
+    for (int i = 0; i < fill; ++i) {
+        smallest.insert({i, i});
+    }
+    for (int i = 0; i < fill; ++i) {
+        smallest.erase(i);
+    }
+    ASSERT_EQ(smallest.capacity(), smallestCapacity);
+    ASSERT_EQ(smallest.stats().shrinks, 0UL);
+    ASSERT_EQ(smallest.stats().rehashes, 0UL);
+}
+
+TEST(HashMap, IncrementalResize) {
+    using Map = HashMap<int, std::string, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+
+    Map map;
+    std::unordered_map<int, std::string> expected;
+    for (int i = 0; i < 5000; ++i) {
+        map.insert({i, std::to_string(i)});
+        expected.insert({i, std::to_string(i)});
+        if (i % 3 == 1) {
+            ASSERT_TRUE(map.erase(i / 2) == (expected.erase(i / 2) == 1));
+        }
+        // Lookups must see elements in both tables while migrating
+        const Map &constMap = map;
+        ASSERT_TRUE(constMap.contains(i));
+        ASSERT_EQ(constMap.find(i)->second, std::to_string(i));
+        int earlier = (i * 7) % (i + 1);
+        ASSERT_EQ(constMap.contains(earlier), expected.count(earlier) == 1);
+        ASSERT_EQ(map.size(), expected.size());
+    }
+
+    // Copies made partway through a migration hold every element
+    Map copy(map);
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT_EQ(map.contains(i), expected.count(i) == 1);
+        ASSERT_EQ(copy.contains(i), expected.count(i) == 1);
+        if (expected.count(i) == 1) {
+            ASSERT_EQ(map.at(i), expected[i]);
+        }
+    }
+}
+
+TEST(HashMap, IterateDuringIncrementalResize) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+
+    Map map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, i});
+        // Every element is visited exactly once, in either table
+        std::vector<int> seen;
+        for (const auto &[key, value] : std::as_const(map)) {
+            ASSERT_EQ(key, value);
+            seen.push_back(key);
+        }
+        std::sort(seen.begin(), seen.end());
+        ASSERT_EQ(seen.size(), map.size());
+        for (int j = 0; j <= i; ++j) {
+            ASSERT_EQ(seen[j], j);
+        }
+    }
+
+    // Erase the first element iterated over, which may still be in the old table
+    while (!map.empty()) {
+        int key = map.begin()->first;
+        ASSERT_TRUE(map.erase(map.begin()));
+        ASSERT_FALSE(map.contains(key));
+    }
+    ASSERT_EQ(map.begin(), map.end());
+}
+
+TEST(HashMap, FindDuringIncrementalResize) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+
+    Map map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, i});
+        // Non-const lookups must not migrate elements out from under an iteration
+        std::vector<int> seen;
+        for (auto it = map.begin(); it != map.end(); ++it) {
+            seen.push_back(it->first);
+            ASSERT_EQ(map.find(it->first), it);
+            ASSERT_EQ(map.at(it->first), it->first);
+            ASSERT_NE(map.find(i - it->first), map.end());
+        }
+        std::sort(seen.begin(), seen.end());
+        ASSERT_EQ(seen.size(), map.size());
+        for (int j = 0; j <= i; ++j) {
+            ASSERT_EQ(seen[j], j);
+        }
+    }
+}
+
+TEST(HashMap, IncrementalResizeBoundsMoves) {
+    static size_t moveCount = 0;
+    struct Mover {
+        Mover() = default;
+        Mover(Mover &&other) noexcept {
+            (void)other;
+            ++moveCount;
+        }
+    };
+    using Map = HashMap<int, Mover, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+
+    Map map(1024);
+    size_t maxMoves = 0;
+    for (int i = 0; i < 10000; ++i) {
+        moveCount = 0;
+        map.insert({i, Mover{}});
+        maxMoves = std::max(maxMoves, moveCount);
+    }
+    ASSERT_GT(map.capacity(), 1024UL * 8);
+    // Each insert moves its own value twice plus at most one batch of migrated slots
+    ASSERT_LE(maxMoves, 2 + IncrementalHashMapPolicy::MigrationBatchSize);
+}
+
+TEST(HashMap, TransparentLookup) {
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+    struct StringEq {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const {
+            return a == b;
+        }
+    };
+
+    HashMap<std::string, int, StringHash, StringEq> map;
+    map.insert({"a fairly long key that does not fit in SSO", 1});
+    map.insert({"short", 2});
+
+    // std::string_view does not implicitly convert to std::string, so these
+    // only compile through the transparent overloads
+    std::string_view longKey = "a fairly long key that does not fit in SSO";
+    ASSERT_TRUE(map.contains(longKey));
+    ASSERT_EQ(map.find(longKey)->second, 1);
+    ASSERT_EQ(map.at(std::string_view("short")), 2);
+    ASSERT_FALSE(map.contains(std::string_view("missing")));
+    ASSERT_EQ(map.find("short")->second, 2);
+
+    map[std::string_view("new")] = 3;
+    ASSERT_EQ(map.at("new"), 3);
+
+    ASSERT_TRUE(map.erase(longKey));
+    ASSERT_FALSE(map.contains(longKey));
+    ASSERT_EQ(map.size(), 2UL);
+}
+
+TEST(HashMap, TryEmplace) {
+    static size_t constructCount = 0;
+    struct Heavy {
+        Heavy(int a, int b)
+            : sum(a + b) {
+            ++constructCount;
+        }
+        int sum;
+    };
+
+    HashMap<int, Heavy, IntHasher> map;
+    auto [it, inserted] = map.try_emplace(1, 2, 3);
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(it->second.sum, 5);
+    ASSERT_EQ(constructCount, 1UL);
+
+    // No value is constructed for an existing key
+    auto [existing, insertedAgain] = map.try_emplace(1, 10, 10);
+    ASSERT_FALSE(insertedAgain);
+    ASSERT_EQ(existing, it);
+    ASSERT_EQ(existing->second.sum, 5);
+    ASSERT_EQ(constructCount, 1UL);
+
+    // An existing rvalue key is not moved from
+    HashMap<std::string, std::string> strings;
+    strings.try_emplace("key", "value");
+    std::string key = "key";
+    ASSERT_FALSE(strings.try_emplace(std::move(key), "other").second);
+    ASSERT_EQ(key, "key");
+    ASSERT_EQ(strings.at("key"), "value");
+}
+
+TEST(HashMap, InsertOrAssign) {
+    HashMap<int, std::string, IntHasher> map;
+    auto [it, inserted] = map.insert_or_assign(1, "abc");
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(it->second, "abc");
+
+    auto [assigned, insertedAgain] = map.insert_or_assign(1, std::string("def"));
+    ASSERT_FALSE(insertedAgain);
+    ASSERT_EQ(assigned, it);
+    ASSERT_EQ(map.at(1), "def");
+    ASSERT_EQ(map.size(), 1UL);
+}
+
+TEST(HashMap, Emplace) {
+    HashMap<int, std::string, IntHasher> map;
+    ASSERT_TRUE(map.emplace(1, "one").second);
+    ASSERT_FALSE(map.emplace(1, "uno").second);
+    ASSERT_TRUE(map.emplace(std::make_pair(2, std::string("two"))).second);
+    ASSERT_TRUE(map.emplace(std::piecewise_construct,
+                            std::forward_as_tuple(3),
+                            std::forward_as_tuple(3, 'x'))
+                    .second);
+    ASSERT_FALSE(map.emplace(std::piecewise_construct,
+                             std::forward_as_tuple(3),
+                             std::forward_as_tuple(1, 'y'))
+                     .second);
+
+    ASSERT_EQ(map.size(), 3UL);
+    ASSERT_EQ(map.at(1), "one");
+    ASSERT_EQ(map.at(2), "two");
+    ASSERT_EQ(map.at(3), "xxx");
+}
+
+TEST(HashMap, OperatorSquareBracketMovesKey) {
+    HashMap<std::string, int> map;
+    std::string key = "a key long enough to be heap allocated";
+    map[std::move(key)] = 5;
+    ASSERT_TRUE(key.empty()); // NOLINT(bugprone-use-after-move)
+    ASSERT_EQ(map.at("a key long enough to be heap allocated"), 5);
+    map["a key long enough to be heap allocated"] += 1;
+    ASSERT_EQ(map.at("a key long enough to be heap allocated"), 6);
+    ASSERT_EQ(map.size(), 1UL);
+}
+
+#if defined(DNSGE_HASHMAP_HAVE_PMR)
+
+/**
+ * @brief Memory resource that counts outstanding allocations.
+ */
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t outstandingBytes = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++this->allocations;
+        this->outstandingBytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        this->outstandingBytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(HashMap, PmrAllocator) {
+    CountingResource resource;
+    {
+        pmr::HashMap<int, std::pmr::string, IntHasher> map(&resource);
+        for (int i = 0; i < 200; ++i) {
+            map.insert({i, std::pmr::string(50, 'x')});
+        }
+        ASSERT_GT(resource.allocations, 200UL);
+
+        // Elements are constructed with the map's allocator
+        ASSERT_EQ(map.at(5).get_allocator().resource(), &resource);
+
+        auto copy = map;
+        ASSERT_EQ(copy.size(), 200UL);
+    }
+    ASSERT_EQ(resource.outstandingBytes, 0UL);
+}
+
+TEST(HashMap, PmrMoveAssignAcrossResources) {
+    CountingResource resource1;
+    CountingResource resource2;
+    {
+        pmr::HashMap<int, int, IntHasher> map1(&resource1);
+        pmr::HashMap<int, int, IntHasher> map2(&resource2);
+        for (int i = 0; i < 100; ++i) {
+            map1.insert({i, i});
+        }
+
+        // Allocators do not propagate, so map2 keeps its resource
+        map2 = std::move(map1);
+        ASSERT_EQ(map2.get_allocator().resource(), &resource2);
+        ASSERT_EQ(map2.size(), 100UL);
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_EQ(map2.at(i), i);
+        }
+        ASSERT_TRUE(map1.empty());
+        ASSERT_EQ(resource1.outstandingBytes != 0, map1.capacity() != 0);
+    }
+    ASSERT_EQ(resource1.outstandingBytes, 0UL);
+    ASSERT_EQ(resource2.outstandingBytes, 0UL);
+}
+
+TEST(HashMap, MonotonicBuffer) {
+    std::array<std::byte, 1 << 16> buffer{};
+    std::pmr::monotonic_buffer_resource arena(
+        buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    using Map = pmr::HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+    Map map(&arena);
+    for (int i = 0; i < 500; ++i) {
+        map.insert({i, -i});
+    }
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_EQ(map.at(i), -i);
+    }
+}
+
+TEST(NodeHashMap, PmrAllocator) {
+    CountingResource resource;
+    {
+        pmr::NodeHashMap<int, std::pmr::string, IntHasher> map(&resource);
+        for (int i = 0; i < 200; ++i) {
+            map.insert({i, std::pmr::string(50, 'x')});
+        }
+        for (int i = 0; i < 100; ++i) {
+            map.erase(i);
+        }
+        ASSERT_EQ(map.at(150).get_allocator().resource(), &resource);
+    }
+    ASSERT_EQ(resource.outstandingBytes, 0UL);
+}
+
+TEST(HashMap, SingleAllocationPerTable) {
+    CountingResource resource;
+    pmr::HashMap<int, int, IntHasher> map(&resource);
+    ASSERT_EQ(resource.allocations, 1UL);
+
+    map.reserve(1000);
+    ASSERT_EQ(resource.allocations, 2UL);
+    for (int i = 0; i < 500; ++i) {
+        map.insert({i, i});
+    }
+    ASSERT_EQ(resource.allocations, 2UL);
+}
+
+#endif
+
+TEST(NodeHashMap, PointerStability) {
+    NodeHashMap<int, std::string, IntHasher> map(4);
+    std::vector<const std::string*> addresses;
+    for (int i = 0; i < 1000; ++i) {
+        auto it = map.insert({i, std::to_string(i)});
+        ASSERT_TRUE(it.has_value());
+        addresses.push_back(&(*it)->second);
+    }
+    // Churn to force in-place rehashes as well as growth
+    for (int i = 1000; i < 3000; ++i) {
+        map.insert({i, std::to_string(i)});
+        map.erase(i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto it = map.find(i);
+        ASSERT_NE(it, map.end());
+        ASSERT_EQ(&it->second, addresses[i]);
+        ASSERT_EQ(it->second, std::to_string(i));
+    }
+
+    auto copy = map;
+    ASSERT_EQ(copy.size(), 1000UL);
+    ASSERT_EQ(copy.at(10), "10");
+    ASSERT_NE(&copy.at(10), &map.at(10));
+}
+
+TEST(NodeHashMap, IncrementalResize) {
+    using Map = NodeHashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+    Map map(4);
+    std::vector<const int*> addresses;
+    for (int i = 0; i < 1000; ++i) {
+        addresses.push_back(&map[i]);
+        map[i] = i;
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(&map.at(i), addresses[i]);
+        ASSERT_EQ(map.at(i), i);
+    }
+}
+
+TEST(NodeHashMap, ImmovableValue) {
+    struct Immovable {
+        explicit Immovable(int value)
+            : value(value) {}
+        Immovable(const Immovable &other) = delete;
+        Immovable &operator=(const Immovable &other) = delete;
+        int value;
+    };
+
+    NodeHashMap<int, Immovable, IntHasher> map(4);
+    for (int i = 0; i < 100; ++i) {
+        map.try_emplace(i, i * 2);
+    }
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(map.at(i).value, i * 2);
+    }
+}
+
+TEST(HashMap, LargeTablePolicy) {
+    // One slot per cache line, so that every slot must be aligned
+    using Value = std::array<char, 60>;
+    static_assert(sizeof(std::pair<const int, Value>) == detail::CacheLineSize);
+    HashMap<int, Value, IntHasher, std::equal_to<int>, LargeTableHashMapPolicy> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, Value{static_cast<char>(i)}});
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto it = map.find(i);
+        ASSERT_NE(it, map.end());
+        ASSERT_EQ(it->second[0], static_cast<char>(i));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(&*it) % detail::CacheLineSize, 0UL);
+    }
+}
+
+TEST(TableStorage, Alignment) {
+    for (size_t alignment : {size_t(1), size_t(64), detail::HugePageSize}) {
+        TableStorage<double> storage(17, 100, alignment);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(storage.bytes()) % alignment, 0UL);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(storage.data()) % alignment, 0UL);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(storage.data()) % alignof(double), 0UL);
+        ASSERT_GE(reinterpret_cast<unsigned char*>(storage.data()), storage.bytes() + 17);
+        // The whole extent is usable
+        storage.bytes()[16] = 1;
+        storage[99] = 1.0;
+    }
+}
+
+TEST(HashMap, FindBatch) {
+    using Map = HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy>;
+    Map map;
+    // Stop partway through a migration so that both tables are searched
+    for (int i = 0; i < 1000; i += 2) {
+        map.insert({i, -i});
+    }
+
+    std::vector<int> keys;
+    for (int i = 999; i >= 0; --i) {
+        keys.push_back(i);
+    }
+    std::vector<Map::const_iterator> found;
+    std::as_const(map).find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+    std::vector<bool> present;
+    map.contains_batch(keys.begin(), keys.end(), std::back_inserter(present));
+    ASSERT_EQ(found.size(), keys.size());
+    ASSERT_EQ(present.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(present[i], keys[i] % 2 == 0);
+        ASSERT_EQ(found[i] != map.cend(), keys[i] % 2 == 0);
+        if (present[i]) {
+            ASSERT_EQ(found[i]->second, -keys[i]);
+        }
+    }
+
+    std::vector<Map::iterator> mutableFound(keys.size());
+    auto end = map.find_batch(keys.begin(), keys.end(), mutableFound.begin());
+    ASSERT_EQ(end, mutableFound.end());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(mutableFound[i] == map.find(keys[i]), true);
+    }
+
+    // Batches of any length, including none
+    ASSERT_EQ(map.find_batch(keys.begin(), keys.begin(), mutableFound.begin()),
+              mutableFound.begin());
+    map.prefetch(5);
+}
+
+TEST(HashMap, FindBatchTransparent) {
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+    struct StringEq {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const {
+            return a == b;
+        }
+    };
+
+    HashMap<std::string, int, StringHash, StringEq> map;
+    map.insert({"one", 1});
+    map.insert({"two", 2});
+    std::array<std::string_view, 3> keys = {"two", "three", "one"};
+    std::array<bool, 3> present{};
+    map.contains_batch(keys.begin(), keys.end(), present.begin());
+    ASSERT_EQ(present, (std::array<bool, 3>{true, false, true}));
+}
+
+TEST(HashMap, PrecomputedHash) {
+    HashMap<std::string, int> cache;
+    HashMap<std::string, int> dedupe;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 500; ++i) {
+        keys.push_back("key-" + std::to_string(i));
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        // Hash once, use in both maps
+        size_t hash = cache.hash_function()(keys[i]);
+        ASSERT_TRUE(cache.insert_hashed({keys[i], static_cast<int>(i)}, hash).has_value());
+        ASSERT_TRUE(dedupe.insert_hashed(std::make_pair(keys[i], 0), hash).has_value());
+        ASSERT_FALSE(dedupe.insert_hashed({keys[i], 1}, hash).has_value());
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t hash = std::hash<std::string>()(keys[i]);
+        ASSERT_TRUE(dedupe.contains(keys[i], hash));
+        ASSERT_EQ(cache.find(keys[i], hash)->second, static_cast<int>(i));
+        ASSERT_EQ(std::as_const(cache).find(keys[i], hash), cache.find(keys[i]));
+    }
+    ASSERT_TRUE(cache.key_eq()("a", "a"));
+}
+
+struct CountingHasher {
+    size_t operator()(int key) const {
+        ++calls;
+        return IntHasher()(key);
+    }
+    static inline size_t calls = 0;
+};
+
+struct StoreHashPolicy : DefaultHashMapPolicy {
+    static constexpr bool StoreHash = true;
+};
+
+struct StoreHashIncrementalPolicy : IncrementalHashMapPolicy {
+    static constexpr bool StoreHash = true;
+};
+
+TEST(HashMap, StoreHashSkipsHasherOnGrowth) {
+    HashMap<int, std::string, CountingHasher, std::equal_to<int>, StoreHashPolicy> map(4);
+    for (int i = 0; i < 2000; ++i) {
+        map.insert({i, std::to_string(i)});
+    }
+    // One hash per insertion, none while growing
+    ASSERT_EQ(CountingHasher::calls, 2000UL);
+
+    // Erase churn rehashes in place from the stored hashes as well
+    for (int i = 0; i < 2000; i += 2) {
+        map.erase(i);
+        map.insert({i + 10000, std::to_string(i + 10000)});
+    }
+    ASSERT_EQ(CountingHasher::calls, 4000UL);
+    auto copy = map;
+    for (int i = 0; i < 2000; ++i) {
+        int key = i % 2 == 0 ? i + 10000 : i;
+        ASSERT_EQ(map.at(key), std::to_string(key));
+        ASSERT_EQ(copy.at(key), std::to_string(key));
+    }
+
+    // Migrations read the old table's stored hashes
+    CountingHasher::calls = 0;
+    using Map = HashMap<int, int, CountingHasher, std::equal_to<int>, StoreHashIncrementalPolicy>;
+    Map incremental(4);
+    for (int i = 0; i < 2000; ++i) {
+        incremental.insert({i, i});
+    }
+    ASSERT_EQ(CountingHasher::calls, 2000UL);
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_EQ(incremental.at(i), i);
+    }
+}
+
+TEST(HashMap, ExtractAndInsertNode) {
+    HashMap<int, std::string, IntHasher> map1;
+    HashMap<int, std::string, IntHasher> map2;
+    for (int i = 0; i < 100; ++i) {
+        map1.insert({i, std::to_string(i)});
+    }
+    auto node = map1.extract(5);
+    ASSERT_FALSE(node.empty());
+    ASSERT_EQ(node.key(), 5);
+    ASSERT_EQ(node.mapped(), "5");
+    ASSERT_FALSE(map1.contains(5));
+    ASSERT_EQ(map1.size(), 99UL);
+    ASSERT_TRUE(map1.extract(5).empty());
+
+    auto inserted = map2.insert(std::move(node));
+    ASSERT_TRUE(inserted.has_value());
+    ASSERT_EQ((*inserted)->second, "5");
+    ASSERT_TRUE(node.empty());
+    ASSERT_FALSE(map2.insert(std::move(node)).has_value());
+
+    // A node whose key is present is left untouched
+    map2.insert({6, "six"});
+    auto six = map1.extract(map1.find(6));
+    ASSERT_FALSE(map2.insert(std::move(six)).has_value());
+    ASSERT_EQ(six.mapped(), "6");
+    ASSERT_EQ(map2.at(6), "six");
+    ASSERT_TRUE(map1.insert(std::move(six)).has_value());
+    ASSERT_EQ(map1.at(6), "6");
+
+    // Nodes of node storage keep their element in place
+    NodeHashMap<int, std::string, IntHasher> nodes1;
+    NodeHashMap<int, std::string, IntHasher> nodes2;
+    nodes1.insert({1, "one"});
+    const std::string* address = &nodes1.at(1);
+    nodes2.insert(nodes1.extract(1));
+    ASSERT_EQ(&nodes2.at(1), address);
+
+    // Extracting during an incremental resize takes elements from either table
+    HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> growing(16);
+    for (int i = 0; i < 1000; ++i) {
+        growing.insert({i, i});
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT_EQ(growing.extract(i).mapped(), i);
+    }
+    ASSERT_EQ(growing.size(), 500UL);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(growing.contains(i), i % 2 == 1);
+    }
+}
+
+TEST(HashMap, Merge) {
+    using Map = HashMap<int, std::string, CountingHasher, std::equal_to<int>, StoreHashPolicy>;
+    Map target;
+    Map source;
+    for (int i = 0; i < 1000; ++i) {
+        target.insert({i, "target"});
+        source.insert({i + 500, "source"});
+    }
+    CountingHasher::calls = 0;
+    ASSERT_EQ(target.merge(source), 500UL);
+    // Stored hashes are reused, both to probe and to grow
+    ASSERT_EQ(CountingHasher::calls, 0UL);
+    ASSERT_EQ(target.size(), 1500UL);
+    for (int i = 0; i < 1500; ++i) {
+        ASSERT_EQ(target.at(i), i < 1000 ? "target" : "source");
+    }
+    // Duplicate keys stay behind
+    ASSERT_EQ(source.size(), 500UL);
+    for (const auto &[key, value] : source) {
+        ASSERT_LT(key, 1000);
+        ASSERT_EQ(value, "source");
+    }
+
+    // An empty map takes over the whole table
+    Map empty;
+    size_t capacity = source.capacity();
+    CountingHasher::calls = 0;
+    ASSERT_EQ(empty.merge(std::move(source)), 500UL);
+    ASSERT_EQ(CountingHasher::calls, 0UL);
+    ASSERT_EQ(empty.capacity(), capacity);
+    ASSERT_TRUE(source.empty());
+    source.insert({1, "reused"});
+    ASSERT_EQ(source.at(1), "reused");
+
+    // A target with a lower max load factor grows the table it takes over
+    Map full;
+    size_t fullCapacity = full.capacity();
+    for (int i = 0; full.load_factor() < Map::MaxLoadFactor - 0.1f; ++i) {
+        full.insert({i, "full"});
+    }
+    ASSERT_EQ(full.capacity(), fullCapacity);
+    Map sparse;
+    sparse.max_load_factor(0.5f);
+    size_t fullSize = full.size();
+    ASSERT_EQ(sparse.merge(full), fullSize);
+    ASSERT_GT(sparse.capacity(), fullCapacity);
+    ASSERT_LE(sparse.load_factor(), 0.5f);
+    for (int i = 0; i < static_cast<int>(fullSize); ++i) {
+        ASSERT_EQ(sparse.at(i), "full");
+    }
+
+    // Hashers with different seeds rehash every key
+    using Seeded = HashMap<int, int, SeededHash<int>>;
+    Seeded seeded1(16, SeededHash<int>(1));
+    Seeded seeded2(16, SeededHash<int>(2));
+    for (int i = 0; i < 100; ++i) {
+        seeded2.insert({i, i});
+    }
+    ASSERT_EQ(seeded1.merge(seeded2), 100UL);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(seeded1.at(i), i);
+    }
+    ASSERT_TRUE(seeded2.empty());
+
+    // A source in the middle of an incremental resize is merged whole
+    HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> growing(16);
+    HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> merged;
+    merged.insert({-1, -1});
+    for (int i = 0; i < 1000; ++i) {
+        growing.insert({i, i});
+    }
+    ASSERT_EQ(merged.merge(growing), 1000UL);
+    ASSERT_EQ(merged.size(), 1001UL);
+    for (int i = -1; i < 1000; ++i) {
+        ASSERT_EQ(merged.at(i), i);
+    }
+
+    HashSet<int, IntHasher> set1{};
+    HashSet<int, IntHasher> set2{};
+    for (int i = 0; i < 10; ++i) {
+        set1.insert(i);
+        set2.insert(i + 5);
+    }
+    ASSERT_EQ(set1.merge(set2), 5UL);
+    ASSERT_EQ(set1.size(), 15UL);
+    ASSERT_EQ(set2.size(), 5UL);
+    auto key = set2.extract(7);
+    ASSERT_EQ(key.value(), 7);
+    ASSERT_FALSE(set1.insert(std::move(key)).has_value());
+}
+
+TEST(HashMap, Iterate) {
+    HashMap<int, std::string, IntHasher> map;
+    ASSERT_EQ(map.begin(), map.end());
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, std::to_string(i)});
+    }
+    // Leave the table sparse
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 13 != 0) {
+            map.erase(i);
+        }
+    }
+
+    std::vector<int> keys;
+    for (auto &[key, value] : map) {
+        ASSERT_EQ(value, std::to_string(key));
+        value += "!";
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    ASSERT_EQ(keys.size(), map.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(keys[i], static_cast<int>(i * 13));
+    }
+
+    const auto &constMap = map;
+    HashMap<int, std::string, IntHasher>::const_iterator it = map.begin();
+    ASSERT_EQ(it, constMap.cbegin());
+    ASSERT_EQ(std::distance(constMap.begin(), constMap.end()),
+              static_cast<std::ptrdiff_t>(map.size()));
+    for (auto p = constMap.cbegin(); p != constMap.cend(); p++) {
+        ASSERT_EQ(p->second, std::to_string(p->first) + "!");
+    }
+}
+
+TEST(Group, MatchesPortable) {
+    std::vector<detail::metadata_t> bytes(3 * detail::Group::Width);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        switch (i % 5) {
+        case 0:
+            bytes[i] = detail::Metadata::Empty;
+            break;
+        case 1:
+            bytes[i] = detail::Metadata::Deleted;
+            break;
+        case 2:
+            bytes[i] = detail::Metadata::Sentinel;
+            break;
+        default:
+            bytes[i] = detail::H2(i * 31);
+        }
+    }
+
+    for (size_t offset = 0; offset < bytes.size() - detail::Group::Width; ++offset) {
+        detail::Group group(bytes.data() + offset);
+        std::vector<uint32_t> empty;
+        std::vector<uint32_t> free;
+        std::vector<uint32_t> full;
+        for (uint32_t i : group.matchEmpty()) {
+            empty.push_back(i);
+        }
+        for (uint32_t i : group.matchEmptyOrDeleted()) {
+            free.push_back(i);
+        }
+        for (uint32_t i : group.matchFull()) {
+            full.push_back(i);
+        }
+
+        std::vector<uint32_t> expectedEmpty;
+        std::vector<uint32_t> expectedFree;
+        std::vector<uint32_t> expectedFull;
+        for (uint32_t i = 0; i < detail::Group::Width; ++i) {
+            auto metadata = bytes[offset + i];
+            if (metadata == detail::Metadata::Empty) {
+                expectedEmpty.push_back(i);
+            }
+            if (metadata == detail::Metadata::Empty || metadata == detail::Metadata::Deleted) {
+                expectedFree.push_back(i);
+            }
+            if (!detail::IsFree(metadata)) {
+                expectedFull.push_back(i);
+            }
+            // Every matching byte must be reported
+            bool found = false;
+            for (uint32_t j : group.match(metadata & 0x7F)) {
+                found = found || j == i;
+            }
+            ASSERT_TRUE(found || detail::IsFree(metadata));
+        }
+        ASSERT_EQ(empty, expectedEmpty);
+        ASSERT_EQ(free, expectedFree);
+        ASSERT_EQ(full, expectedFull);
+
+        // The portable implementation must agree on its own width
+        detail::GroupPortable portable(bytes.data() + offset);
+        std::vector<uint32_t> portableFree;
+        for (uint32_t i : portable.matchEmptyOrDeleted()) {
+            portableFree.push_back(i);
+        }
+        std::vector<uint32_t> narrowFree;
+        for (uint32_t i : free) {
+            if (i < detail::GroupPortable::Width) {
+                narrowFree.push_back(i);
+            }
+        }
+        ASSERT_EQ(portableFree, narrowFree);
+    }
+}
+
+TEST(ConcurrentHashMap, ParallelInsert) {
+    constexpr int NumThreads = 8;
+    constexpr int PerThread = 2000;
+    ConcurrentHashMap<int, int, IntHasher> map;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NumThreads; ++t) {
+        threads.emplace_back([&map, t] {
+            for (int i = 0; i < PerThread; ++i) {
+                int key = t * PerThread + i;
+                ASSERT_TRUE(map.insert({key, key * 2}));
+                // Every thread also bumps a shared counter
+                map.insert_or_visit({-1, 1}, [](auto &slot) { ++slot.second; });
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(map.size(), static_cast<size_t>(NumThreads * PerThread + 1));
+    ASSERT_EQ(map.get(-1), NumThreads * PerThread);
+    for (int key = 0; key < NumThreads * PerThread; ++key) {
+        ASSERT_EQ(map.get(key), key * 2);
+    }
+    ASSERT_FALSE(map.get(NumThreads * PerThread).has_value());
+
+    size_t visited = 0;
+    map.for_each([&](const auto &) { ++visited; });
+    ASSERT_EQ(visited, map.size());
+
+    for (int key = 100; key < NumThreads * PerThread; ++key) {
+        map.erase(key);
+    }
+    map.shrink_to_fit();
+    ASSERT_EQ(map.size(), 101UL);
+    ASSERT_EQ(map.get(99), 198);
+}
+
+TEST(ConcurrentHashMap, EraseIf) {
+    constexpr int NumKeys = 10000;
+    ConcurrentHashMap<int, int, IntHasher> map;
+    for (int key = 0; key < NumKeys; ++key) {
+        map.insert({key, key});
+    }
+
+    // Keys inserted during the sweep are negative, so the predicate keeps them
+    std::thread inserter([&map] {
+        for (int key = 1; key <= NumKeys; ++key) {
+            map.insert({-key, key});
+        }
+    });
+    size_t erased = map.erase_if([](const auto &slot) { return slot.first % 2 == 1; });
+    inserter.join();
+
+    ASSERT_EQ(erased, static_cast<size_t>(NumKeys / 2));
+    ASSERT_EQ(map.size(), static_cast<size_t>(NumKeys / 2 + NumKeys));
+    for (int key = 0; key < NumKeys; ++key) {
+        ASSERT_EQ(map.contains(key), key % 2 == 0);
+        ASSERT_EQ(map.get(-key - 1), key + 1);
+    }
+}
+
+TEST(ConcurrentHashMap, AtomicOperations) {
+    ConcurrentHashMap<int, int, IntHasher> map(1);
+    ASSERT_EQ(map.shardCount(), 1u);
+    ASSERT_TRUE(map.empty());
+
+    auto increment = [](const int *value) { return std::optional<int>(value ? *value + 1 : 0); };
+    ASSERT_TRUE(map.compute(1, increment));
+    ASSERT_TRUE(map.compute(1, increment));
+    ASSERT_EQ(map.get(1), 1);
+    ASSERT_FALSE(map.compute(1, [](const int *) { return std::optional<int>(); }));
+    ASSERT_FALSE(map.contains(1));
+
+    ASSERT_TRUE(map.insert_or_assign(2, 20));
+    ASSERT_FALSE(map.insert_or_assign(2, 21));
+    ASSERT_FALSE(map.insert({2, 22}));
+    ASSERT_TRUE(map.visit(2, [](auto &slot) { slot.second += 1; }));
+    ASSERT_EQ(map.get(2), 22);
+
+    ASSERT_FALSE(map.erase_if(2, [](const auto &slot) { return slot.second != 22; }));
+    ASSERT_TRUE(map.erase_if(2, [](const auto &slot) { return slot.second == 22; }));
+    ASSERT_FALSE(map.erase(2));
+
+    map.reserve(100);
+    map.insert({3, 3});
+    map.clear();
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ((ConcurrentHashMap<int, int>(5).shardCount()), 8u);
+}
+
+TEST(ReadMostlyHashMap, ReadersDuringUpdates) {
+    constexpr int NumKeys = 512;
+    ReadMostlyHashMap<int, int, IntHasher> map;
+    map.update([&](auto &snapshot) {
+        for (int i = 0; i < NumKeys; ++i) {
+            snapshot.insert({i, 0});
+        }
+    });
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                // Every snapshot has all keys at the same version
+                map.read([&](const auto &snapshot) {
+                    int version = snapshot.at(0);
+                    for (int i = 0; i < NumKeys; ++i) {
+                        ASSERT_EQ(snapshot.at(i), version);
+                    }
+                });
+            }
+        });
+    }
+    for (int version = 1; version <= 200; ++version) {
+        map.update([&](auto &snapshot) {
+            for (auto &entry : snapshot) {
+                entry.second = version;
+            }
+        });
+    }
+    done.store(true);
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQ(map.get(NumKeys - 1), 200);
+}
+
+TEST(ReadMostlyHashMap, ReclaimsAfterReaders) {
+    ReadMostlyHashMap<int, std::string, IntHasher> map;
+    ASSERT_TRUE(map.insert({1, "one"}));
+    ASSERT_FALSE(map.insert({1, "uno"}));
+    ASSERT_EQ(map.retired(), 0u);
+
+    map.read([&](const auto &snapshot) {
+        // A reader keeps the snapshots it could see alive
+        ASSERT_TRUE(map.insert_or_assign(2, "two"));
+        ASSERT_TRUE(map.erase(1));
+        ASSERT_EQ(map.retired(), 2u);
+        ASSERT_EQ(snapshot.at(1), "one");
+        ASSERT_FALSE(snapshot.contains(2));
+        ASSERT_TRUE(map.contains(2));
+    });
+    ASSERT_TRUE(map.insert({3, "three"}));
+    ASSERT_EQ(map.retired(), 0u);
+    ASSERT_EQ(map.size(), 2u);
+    ASSERT_EQ(map.get(2), "two");
+    ASSERT_FALSE(map.get(1).has_value());
+}
+
+struct ParallelRehashPolicy : PowerOfTwoHashMapPolicy {
+    static constexpr bool StoreHash = true;
+    static constexpr size_t ParallelRehashThreshold = 1 << 17;
+};
+
+TEST(HashMap, ParallelRehash) {
+    constexpr int NumElements = 50000;
+    auto check = [&](auto &map) {
+        ASSERT_EQ(map.size(), static_cast<size_t>(NumElements));
+        for (int i = 0; i < NumElements; ++i) {
+            ASSERT_EQ(map.at(i), std::to_string(i));
+        }
+        ASSERT_FALSE(map.contains(NumElements));
+        ASSERT_EQ(std::distance(map.begin(), map.end()), static_cast<std::ptrdiff_t>(NumElements));
+    };
+
+    HashMap<int, std::string, IntHasher> map;
+    for (int i = 0; i < NumElements; ++i) {
+        map.insert({i, std::to_string(i)});
+    }
+    map.reserve(8 * NumElements, ThreadExecutor(4));
+    ASSERT_GE(map.capacity(), static_cast<size_t>(8 * NumElements));
+    check(map);
+
+    // Growing past the threshold rehashes in parallel on its own
+    HashMap<int, std::string, IntHasher, std::equal_to<int>, ParallelRehashPolicy> large;
+    for (int i = 0; i < NumElements; ++i) {
+        large.insert({i, std::to_string(i)});
+    }
+    large.reserve(4 * NumElements);
+    check(large);
+
+    NodeHashMap<int, std::string, IntHasher> nodes;
+    for (int i = 0; i < NumElements; ++i) {
+        nodes.insert({i, std::to_string(i)});
+    }
+    const std::string* pointer = &nodes.at(7);
+    nodes.reserve(8 * NumElements, ThreadExecutor(3));
+    ASSERT_EQ(pointer, &nodes.at(7));
+    check(nodes);
+}
+
+TEST(HashMap, BulkInsert) {
+    std::vector<std::pair<int, std::string>> pairs;
+    for (int i = 0; i < 20000; ++i) {
+        pairs.emplace_back(i, std::to_string(i));
+    }
+    // Duplicates keep the first pair
+    pairs.emplace_back(7, "duplicate");
+
+    HashMap<int, std::string, IntHasher> map(pairs.begin(), pairs.end());
+    ASSERT_EQ(map.size(), 20000u);
+    size_t capacity = map.capacity();
+    for (int i = 0; i < 20000; ++i) {
+        ASSERT_EQ(map.at(i), std::to_string(i));
+    }
+
+    // Keys already present are left alone
+    std::unordered_map<int, std::string> more;
+    for (int i = 19000; i < 21000; ++i) {
+        more[i] = "more";
+    }
+    ASSERT_EQ(map.bulk_insert(more.begin(), more.end(), ThreadExecutor(2)), 1000u);
+    ASSERT_EQ(map.size(), 21000u);
+    ASSERT_EQ(map.at(19500), "19500");
+    ASSERT_EQ(map.at(20500), "more");
+    ASSERT_GE(map.capacity(), capacity);
+
+    // Pairs are moved from through move iterators
+    std::vector<std::pair<int, std::string>> moved = {{1, std::string(32, 'a')}, {2, "b"}};
+    HashMap<int, std::string, IntHasher> small;
+    ASSERT_EQ(small.bulk_insert(std::make_move_iterator(moved.begin()),
+                                std::make_move_iterator(moved.end())),
+              2u);
+    ASSERT_EQ(small.at(1), std::string(32, 'a'));
+    ASSERT_TRUE(moved[0].second.empty());
+}
+
+TEST(MappedHashMap, SaveAndMap) {
+    struct Point {
+        int32_t x;
+        int32_t y;
+    };
+    std::string path = testing::TempDir() + "dnsge_snapshot_test.bin";
+    {
+        HashMap<int, Point, IntHasher> map;
+        for (int i = 0; i < 5000; ++i) {
+            map.insert({i, Point{i, -i}});
+        }
+        for (int i = 0; i < 5000; i += 3) {
+            map.erase(i);
+        }
+        map.save(path);
+    }
+
+    auto mapped = HashMap<int, Point, IntHasher>::map_readonly(path);
+    ASSERT_EQ(mapped.size(), 5000u - 1667u);
+    for (int i = 0; i < 5000; ++i) {
+        const auto* slot = mapped.find(i);
+        if (i % 3 == 0) {
+            ASSERT_EQ(slot, nullptr);
+        } else {
+            ASSERT_NE(slot, nullptr);
+            ASSERT_EQ(slot->second.x, i);
+            ASSERT_EQ(mapped.at(i).y, -i);
+        }
+    }
+    ASSERT_FALSE(mapped.contains(5000));
+    ASSERT_THROW(mapped.at(0), std::out_of_range);
+
+    // The layout must match the reader's policy
+    using StoreHashMapped =
+        MappedHashMap<int, Point, IntHasher, std::equal_to<int>, StoreHashPolicy>;
+    ASSERT_THROW(StoreHashMapped{path}, std::runtime_error);
+    ASSERT_THROW(decltype(mapped)(path + ".missing"), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(MappedHashMap, SeededHash) {
+    using Map = HashMap<uint64_t, uint64_t, SeededHash<uint64_t>>;
+    std::string path = testing::TempDir() + "dnsge_seeded_snapshot_test.bin";
+    {
+        Map map(16, SeededHash<uint64_t>(42));
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map.insert({i, i * 2});
+        }
+        map.save(path);
+    }
+    auto mapped = Map::map_readonly(path, SeededHash<uint64_t>(42));
+    for (uint64_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(mapped.at(i), i * 2);
+    }
+    // A different seed would probe in the wrong places
+    ASSERT_THROW(Map::map_readonly(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(MappedHashMap, SaveDuringIncrementalResize) {
+    std::string path = testing::TempDir() + "dnsge_snapshot_incremental_test.bin";
+    HashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> map;
+    int i = 0;
+    // Stop right after a growth, while the old table is still being migrated
+    while (map.capacity() < 1000) {
+        map.insert({i, i * i});
+        ++i;
+    }
+    map.save(path);
+
+    MappedHashMap<int, int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> mapped(path);
+    ASSERT_EQ(mapped.size(), map.size());
+    for (int j = 0; j < i; ++j) {
+        ASSERT_EQ(mapped.at(j), j * j);
+    }
+    std::remove(path.c_str());
+}
+
+struct Celsius {
+    double degrees;
+};
+
+template <>
+struct dnsge::Codec<Celsius> {
+    template <typename Writer>
+    static void encode(Writer &out, const Celsius &value) {
+        Codec<int64_t>::encode(out, static_cast<int64_t>(value.degrees * 100));
+    }
+
+    template <typename Reader>
+    static Celsius decode(Reader &in) {
+        return Celsius{static_cast<double>(Codec<int64_t>::decode(in)) / 100};
+    }
+};
+
+TEST(HashMap, Serialize) {
+    // More than deserialize() reserves for before reading any element
+    constexpr int NumElements = 100000;
+    HashMap<std::string, std::string> map;
+    for (int i = 0; i < NumElements; ++i) {
+        map.insert({"key" + std::to_string(i), std::string(i % 50, 'v')});
+    }
+
+    // Writes reach the sink in bounded chunks
+    struct Sink {
+        void write(const char* data, size_t n) {
+            maxWrite = std::max(maxWrite, n);
+            bytes.append(data, n);
+        }
+        size_t maxWrite = 0;
+        std::string bytes;
+    } sink;
+    map.serialize(sink);
+    ASSERT_LE(sink.maxWrite, size_t(64) << 10);
+    ASSERT_GT(sink.bytes.size(), sink.maxWrite);
+
+    std::istringstream in(sink.bytes);
+    StreamSource source(in);
+    HashMap<std::string, std::string> loaded;
+    loaded.insert({"stale", "value"});
+    loaded.deserialize(source);
+    HashMap<std::string, std::string> reserved;
+    reserved.reserve(NumElements);
+    ASSERT_EQ(loaded.capacity(), reserved.capacity());
+    ASSERT_EQ(loaded.size(), map.size());
+    ASSERT_FALSE(loaded.contains("stale"));
+    for (const auto &[key, value] : map) {
+        ASSERT_EQ(loaded.at(key), value);
+    }
+
+    // Truncated and foreign input is rejected
+    std::istringstream truncated(sink.bytes.substr(0, sink.bytes.size() / 2));
+    StreamSource truncatedSource(truncated);
+    ASSERT_THROW(loaded.deserialize(truncatedSource), std::runtime_error);
+    std::istringstream foreign("not a hash map at all");
+    StreamSource foreignSource(foreign);
+    ASSERT_THROW(loaded.deserialize(foreignSource), std::runtime_error);
+
+    // A corrupt count fails at the end of the input without allocating for it
+    for (uint64_t count : {uint64_t(1) << 40, ~uint64_t(0)}) {
+        std::string corrupt = sink.bytes;
+        for (size_t i = 0; i < sizeof(count); ++i) {
+            corrupt[sizeof(detail::SerializedHeader::Magic) + sizeof(uint32_t) + i] =
+                static_cast<char>(count >> (8 * i));
+        }
+        std::istringstream corruptIn(corrupt);
+        StreamSource corruptSource(corruptIn);
+        ASSERT_THROW(loaded.deserialize(corruptSource), std::runtime_error);
+        ASSERT_EQ(loaded.size(), map.size());
+    }
+
+    // Data after a map in the same stream is left for the next reader
+    HashMap<std::string, std::string> second;
+    second.insert({"only", "element"});
+    std::ostringstream both;
+    StreamSink bothSink(both);
+    map.serialize(bothSink);
+    second.serialize(bothSink);
+    both << "trailer";
+    std::istringstream bothIn(both.str());
+    StreamSource bothSource(bothIn);
+    HashMap<std::string, std::string> first;
+    first.deserialize(bothSource);
+    loaded.deserialize(bothSource);
+    ASSERT_EQ(first.size(), map.size());
+    ASSERT_EQ(loaded.size(), 1u);
+    ASSERT_EQ(loaded.at("only"), "element");
+    std::string trailer;
+    bothIn >> trailer;
+    ASSERT_EQ(trailer, "trailer");
+}
+
+TEST(HashMap, SerializeCustomCodec) {
+    HashMap<int, Celsius, IntHasher> map;
+    map.insert({1, Celsius{21.5}});
+    map.insert({2, Celsius{-4.25}});
+
+    std::ostringstream out;
+    StreamSink sink(out);
+    map.serialize(sink);
+
+    std::istringstream in(out.str());
+    StreamSource source(in);
+    HashMap<int, Celsius, IntHasher> loaded;
+    loaded.deserialize(source);
+    ASSERT_EQ(loaded.size(), 2u);
+    ASSERT_EQ(loaded.at(1).degrees, 21.5);
+    ASSERT_EQ(loaded.at(2).degrees, -4.25);
+}
+
+TEST(HashMap, Stats) {
+    HashMap<int, int, IntHasher, std::equal_to<int>, StatsHashMapPolicy<>> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, i});
+    }
+    auto before = map.stats();
+    for (int i = 0; i < 2000; ++i) {
+        map.find(i);
+    }
+    auto stats = map.stats();
+    auto lookups = [](const auto &histogram) {
+        return std::accumulate(histogram.begin(), histogram.end(), uint64_t(0));
+    };
+    ASSERT_EQ(lookups(stats.hitProbes) - lookups(before.hitProbes), 1000u);
+    ASSERT_EQ(lookups(stats.missProbes) - lookups(before.missProbes), 1000u);
+    ASSERT_GT(stats.grows, 0u);
+    ASSERT_EQ(stats.size, 1000u);
+    ASSERT_EQ(stats.capacity, map.capacity());
+    ASSERT_GE(stats.bytesAllocated, map.capacity() * sizeof(std::pair<const int, int>));
+    ASSERT_FLOAT_EQ(stats.effectiveLoadFactor, 1000.0f / map.capacity());
+
+    // Erase churn shows up as deleted slots, then in-place rehashes
+    for (int i = 0; i < 1000; ++i) {
+        map.erase(i);
+        map.insert({i + 1000, i});
+    }
+    ASSERT_GT(map.stats().rehashes + map.stats().deletedCount, 0u);
+
+    std::unordered_map<std::string, double> exported;
+    stats.export_metrics([&](std::string_view name, double value) {
+        exported.emplace(std::string(name), value);
+    });
+    ASSERT_EQ(exported.at("size"), 1000.0);
+    ASSERT_EQ(exported.count("hit_probe_groups.0"), 1u);
+    ASSERT_EQ(exported.count("miss_probe_groups.15"), 1u);
+
+    // Copies start counting over
+    auto copy = map;
+    ASSERT_EQ(lookups(copy.stats().hitProbes), 0u);
+    ASSERT_EQ(copy.stats().size, map.size());
+
+    // Without a stats policy only the gauges are reported
+    HashMap<int, int, IntHasher> plain;
+    plain.insert({1, 1});
+    plain.find(1);
+    ASSERT_EQ(lookups(plain.stats().hitProbes), 0u);
+    ASSERT_EQ(plain.stats().size, 1u);
+}
+
+TEST(HashSet, InsertFindErase) {
+    HashSet<std::string> set;
+    ASSERT_TRUE(set.insert("a").second);
+    ASSERT_FALSE(set.insert("a").second);
+    ASSERT_TRUE(set.emplace(3, 'b').second);
+    ASSERT_EQ(*set.find("bbb"), "bbb");
+    ASSERT_TRUE(set.contains("a"));
+    ASSERT_EQ(set.find("c"), set.end());
+    ASSERT_EQ(set.size(), 2u);
+
+    for (int i = 0; i < 1000; ++i) {
+        set.insert(std::to_string(i));
+    }
+    ASSERT_EQ(set.size(), 1002u);
+    ASSERT_EQ(static_cast<size_t>(std::distance(set.begin(), set.end())), set.size());
+    ASSERT_TRUE(set.erase("a"));
+    ASSERT_FALSE(set.erase("a"));
+    ASSERT_TRUE(set.erase(set.find("bbb")));
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(set.contains(std::to_string(i)));
+    }
+    ASSERT_EQ(set.size(), 1000u);
+}
+
+TEST(HashSet, SlotsHoldOnlyKeys) {
+    static_assert(sizeof(HashSet<uint64_t>::value_type) == sizeof(uint64_t));
+    std::vector<uint64_t> keys(10000);
+    std::iota(keys.begin(), keys.end(), 0);
+    HashSet<uint64_t> set(keys.begin(), keys.end());
+    HashMap<uint64_t, uint64_t> map(set.capacity());
+    for (uint64_t key : keys) {
+        map.insert({key, key});
+    }
+    ASSERT_EQ(set.size(), keys.size());
+    ASSERT_EQ(set.capacity(), map.capacity());
+    // Metadata is the same, the slot array is half the size, up to alignment padding
+    ASSERT_NEAR(static_cast<double>(map.stats().bytesAllocated - set.stats().bytesAllocated),
+                static_cast<double>(set.capacity() * sizeof(uint64_t)),
+                static_cast<double>(detail::CacheLineSize));
+}
+
+TEST(HashSet, Policies) {
+    HashSet<int, IntHasher, std::equal_to<int>, IncrementalHashMapPolicy> incremental;
+    HashSet<int, IntHasher, std::equal_to<int>, NodeHashMapPolicy<>> node;
+    for (int i = 0; i < 5000; ++i) {
+        incremental.insert(i);
+        node.insert(i);
+    }
+    for (int i = 0; i < 5000; i += 2) {
+        ASSERT_TRUE(incremental.erase(i));
+        ASSERT_TRUE(node.erase(i));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT_EQ(incremental.contains(i), i % 2 == 1);
+        ASSERT_EQ(node.contains(i), i % 2 == 1);
+    }
+    HashSet<int, IntHasher, std::equal_to<int>, NodeHashMapPolicy<>> copy = node;
+    ASSERT_EQ(copy.size(), 2500u);
+}
+
+TEST(SeededHash, Seeds) {
+    SeededHash<uint64_t> a(1);
+    SeededHash<uint64_t> b(2);
+    ASSERT_EQ(a(12345), SeededHash<uint64_t>(1)(12345));
+    ASSERT_NE(a(12345), b(12345));
+    ASSERT_NE(a(0), a(1));
+
+    SeededHash<std::string> strings(7);
+    std::string key(100, 'x');
+    ASSERT_EQ(strings(key), strings(std::string_view(key)));
+    ASSERT_NE(strings(key), SeededHash<std::string>(8)(key));
+    // Every length takes a different path through the byte hash
+    std::unordered_map<size_t, size_t> seen;
+    for (size_t len = 0; len <= key.size(); ++len) {
+        ASSERT_TRUE(seen.emplace(strings(std::string_view(key.data(), len)), len).second);
+    }
+    ASSERT_NE(SeededHash<std::string>::RandomSeed(), SeededHash<std::string>::RandomSeed());
+}
+
+TEST(HashMap, StatefulHasher) {
+    // Empty function objects take no space
+    ASSERT_EQ(sizeof(HashMap<uint64_t, uint64_t, SeededHash<uint64_t>>),
+              sizeof(HashMap<uint64_t, uint64_t>) + sizeof(uint64_t));
+
+    using Map = HashMap<std::string, int, SeededHash<std::string>, std::equal_to<>>;
+    Map map(16, SeededHash<std::string>(99));
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({std::to_string(i), i});
+    }
+    ASSERT_EQ(map.hash_function().seed(), 99u);
+    ASSERT_EQ(map.at(std::string_view("500")), 500);
+    ASSERT_EQ(map.find("501", map.hash_function()("501"))->second, 501);
+
+    // Copies and moves take the hasher along
+    Map copy = map;
+    ASSERT_EQ(copy.hash_function().seed(), 99u);
+    ASSERT_EQ(copy.at("999"), 999);
+    Map assigned;
+    assigned = std::move(copy);
+    ASSERT_EQ(assigned.hash_function().seed(), 99u);
+    ASSERT_EQ(assigned.at("0"), 0);
+
+    ConcurrentHashMap<std::string, int, SeededHash<std::string>> concurrent(
+        4, SeededHash<std::string>(5));
+    concurrent.insert({"a", 1});
+    ASSERT_EQ(concurrent.get("a"), 1);
+}
+
+TEST(HashMap, MixesWeakHashes) {
+    // std::hash of an integer is the identity, which for these keys leaves the
+    // control bytes and the probe start of a power-of-two table all equal
+    HashMap<uint64_t, int, std::hash<uint64_t>, std::equal_to<uint64_t>,
+            StatsHashMapPolicy<PowerOfTwoHashMapPolicy>>
+        map;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        map.insert({i << 32, 0});
+    }
+    for (uint64_t i = 0; i < 10000; ++i) {
+        ASSERT_NE(map.find(i << 32), map.end());
+    }
+    auto stats = map.stats();
+    uint64_t hits = std::accumulate(stats.hitProbes.begin(), stats.hitProbes.end(), uint64_t(0));
+    ASSERT_GT(stats.hitProbes[0] + stats.hitProbes[1], hits * 9 / 10);
+}
+
+#if defined(DNSGE_HASHMAP_HAVE_PMR)
+
+TEST(SmallHashMap, InlineThenSpill) {
+    CountingResource resource;
+    using Map = SmallHashMap<std::string, int, 8, std::hash<std::string>, std::equal_to<>,
+                             DefaultHashMapPolicy,
+                             std::pmr::polymorphic_allocator<std::pair<const std::string, int>>>;
+    Map map(&resource);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(map.insert({std::to_string(i), i}).has_value());
+    }
+    ASSERT_FALSE(map.insert({"3", 30}).has_value());
+    ASSERT_TRUE(map.is_inline());
+    ASSERT_EQ(resource.allocations, 0u);
+    ASSERT_EQ(map.size(), 8u);
+    ASSERT_EQ(map.at("7"), 7);
+    ASSERT_FALSE(map.contains("8"));
+
+    ASSERT_TRUE(map.erase("0"));
+    ASSERT_FALSE(map.erase("0"));
+    map["8"] = 8;
+    ASSERT_TRUE(map.is_inline());
+    ASSERT_EQ(std::distance(map.begin(), map.end()), 8);
+
+    // The ninth element spills every element into a HashMap
+    map.insert_or_assign("9", 9);
+    ASSERT_FALSE(map.is_inline());
+    ASSERT_GT(resource.allocations, 0u);
+    ASSERT_EQ(map.size(), 9u);
+    for (int i = 1; i < 10; ++i) {
+        ASSERT_EQ(map.at(std::to_string(i)), i);
+    }
+    ASSERT_EQ(std::distance(map.begin(), map.end()), 9);
+
+    map.clear();
+    ASSERT_TRUE(map.is_inline());
+    ASSERT_TRUE(map.empty());
+}
+
+#endif
+
+TEST(SmallHashMap, CopyAndMove) {
+    SmallHashMap<int, std::string, 4, IntHasher> small;
+    SmallHashMap<int, std::string, 4, IntHasher> spilled;
+    for (int i = 0; i < 3; ++i) {
+        small.try_emplace(i, std::to_string(i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        spilled.try_emplace(i, std::to_string(i));
+    }
+    for (const auto *source : {&small, &spilled}) {
+        auto copy = *source;
+        ASSERT_EQ(copy.size(), source->size());
+        ASSERT_EQ(copy.is_inline(), source->is_inline());
+        for (const auto &[key, value] : *source) {
+            ASSERT_EQ(copy.at(key), value);
+        }
+        auto moved = std::move(copy);
+        ASSERT_TRUE(copy.empty());
+        ASSERT_EQ(moved.size(), source->size());
+        copy = moved;
+        ASSERT_EQ(copy.find(2)->second, "2");
+    }
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
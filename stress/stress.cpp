@@ -0,0 +1,571 @@
+#include "ConcurrentHashMap.hpp"
+#include "HashMap.hpp"
+#include "SmallHashMap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace dnsge;
+
+namespace {
+
+/**
+ * @brief Murmur3 finalizer, as in the benchmarks.
+ */
+struct MixHasher {
+    using is_avalanching = void;
+
+    size_t operator()(uint64_t x) const {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+/**
+ * @brief Hash every key to one of a few values, so that keys share level 1 and
+ * level 2 hashes and probes run long past deleted slots.
+ */
+struct ClusterHasher {
+    size_t operator()(uint64_t x) const {
+        return MixHasher()(x % 61);
+    }
+};
+
+struct StoreHashPolicy : DefaultHashMapPolicy {
+    static constexpr bool StoreHash = true;
+};
+
+struct StoreHashIncrementalPolicy : IncrementalHashMapPolicy {
+    static constexpr bool StoreHash = true;
+};
+
+struct ParallelRehashPolicy : PowerOfTwoHashMapPolicy {
+    static constexpr bool StoreHash = true;
+    static constexpr size_t ParallelRehashThreshold = 1 << 12;
+};
+
+struct Options {
+    uint64_t seed = 1;
+    size_t ops = 2000000;
+    size_t keys = 50000;
+    size_t threads = 8;
+    bool latency = false;
+};
+
+[[noreturn]] void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--seed N] [--ops N] [--keys N] [--threads N] [--latency]\n"
+                 "\n"
+                 "Runs random insert/erase/find sequences against every HashMap\n"
+                 "variant and std::unordered_map, failing on the first difference.\n"
+                 "With --latency, records per-operation latency histograms instead.\n",
+                 argv0);
+    std::exit(2);
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&]() -> uint64_t {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+            }
+            return std::strtoull(argv[++i], nullptr, 10);
+        };
+        if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = value();
+        } else if (std::strcmp(argv[i], "--ops") == 0) {
+            options.ops = value();
+        } else if (std::strcmp(argv[i], "--keys") == 0) {
+            options.keys = std::max<uint64_t>(value(), 1);
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = std::max<uint64_t>(value(), 1);
+        } else if (std::strcmp(argv[i], "--latency") == 0) {
+            options.latency = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    return options;
+}
+
+template <typename Map, typename = void>
+struct HasCapacity : std::false_type {};
+
+template <typename Map>
+struct HasCapacity<Map, std::void_t<decltype(std::declval<Map &>().capacity())>>
+    : std::true_type {};
+
+template <typename Map>
+size_t capacityOf(const Map &map) {
+    if constexpr (HasCapacity<Map>::value) {
+        return map.capacity();
+    } else {
+        return map.bucket_count();
+    }
+}
+
+using Reference = std::unordered_map<uint64_t, uint64_t>;
+
+/**
+ * @brief Checks one map against a std::unordered_map through a sequence of
+ * random operations. Every operation is checked as it runs, and the whole map
+ * is compared at the end of every phase.
+ */
+template <typename Map>
+class DifferentialRun {
+public:
+    DifferentialRun(const char* name, const Options &options, size_t keys)
+        : name_(name)
+        , options_(options)
+        , keys_(keys)
+        , rng_(options.seed) {}
+
+    void run() {
+        // Phases alternate between growing, churning and draining the map, so
+        // that the table crosses resize and shrink boundaries in both directions
+        // and accumulates deleted slots in between
+        static constexpr std::array<unsigned, 4> InsertPercent = {80, 50, 20, 50};
+        size_t phaseOps = std::max<size_t>(this->options_.ops / 16, 1);
+        for (this->op_ = 0; this->op_ < this->options_.ops; ++this->op_) {
+            unsigned insertPercent = InsertPercent[(this->op_ / phaseOps) % InsertPercent.size()];
+            this->step(insertPercent);
+            if ((this->op_ + 1) % phaseOps == 0) {
+                this->checkAll();
+            }
+        }
+        this->checkAll();
+        std::printf("%-28s ok  %zu ops, final size %zu\n", this->name_, this->options_.ops,
+                    this->map_.size());
+    }
+
+private:
+    uint64_t randomKey() {
+        return std::uniform_int_distribution<uint64_t>(0, this->keys_ - 1)(this->rng_);
+    }
+
+    void step(unsigned insertPercent) {
+        unsigned roll = std::uniform_int_distribution<unsigned>(0, 99999)(this->rng_);
+        uint64_t key = this->randomKey();
+        uint64_t value = this->rng_();
+        // Rare operations first, in thousandths of a percent
+        if (roll < 1) {
+            this->map_.clear();
+            this->ref_.clear();
+            return;
+        }
+        if (roll < 10) {
+            uint64_t salt = this->rng_() % 5;
+            auto pred = [salt](const auto &slot) { return (slot.first + salt) % 5 == 0; };
+            size_t expected = 0;
+            for (auto it = this->ref_.begin(); it != this->ref_.end();) {
+                if (pred(*it)) {
+                    it = this->ref_.erase(it);
+                    ++expected;
+                } else {
+                    ++it;
+                }
+            }
+            this->expect(this->map_.erase_if(pred) == expected, "erase_if count");
+            return;
+        }
+        if (roll < 60) {
+            this->rareTableOp();
+            return;
+        }
+        if (roll < 70) {
+            // Copies and moves rebuild the table from the elements
+            Map copy = this->map_;
+            this->map_ = std::move(copy);
+            this->expect(this->map_.size() == this->ref_.size(), "size after copy");
+            return;
+        }
+
+        roll = roll % 100;
+        if (roll < insertPercent) {
+            if (roll % 2 == 0) {
+                bool inserted = this->map_.insert({key, value}).has_value();
+                bool expected = this->ref_.insert({key, value}).second;
+                this->expect(inserted == expected, "insert result");
+            } else {
+                auto [it, inserted] = this->map_.insert_or_assign(key, value);
+                bool expected = this->ref_.insert_or_assign(key, value).second;
+                this->expect(inserted == expected, "insert_or_assign result");
+                this->expect(it->first == key && it->second == value, "insert_or_assign iterator");
+            }
+        } else if (roll < insertPercent + (100 - insertPercent) / 2) {
+            if (roll % 2 == 0) {
+                this->expect(this->map_.erase(key) == (this->ref_.erase(key) == 1), "erase result");
+            } else {
+                auto it = this->map_.find(key);
+                bool expected = this->ref_.erase(key) == 1;
+                this->expect((it != this->map_.end()) == expected, "find before erase");
+                this->expect(this->map_.erase(it) == expected, "erase iterator result");
+            }
+        } else {
+            auto it = this->map_.find(key);
+            auto expected = this->ref_.find(key);
+            if (expected == this->ref_.end()) {
+                this->expect(it == this->map_.end(), "find of missing key");
+            } else {
+                this->expect(it != this->map_.end() && it->second == expected->second,
+                             "find of present key");
+            }
+        }
+        this->expect(this->map_.size() == this->ref_.size(), "size");
+    }
+
+    /**
+     * @brief Operations only tables with a capacity support.
+     */
+    void rareTableOp() {
+        if constexpr (HasCapacity<Map>::value) {
+            switch (this->rng_() % 5) {
+            case 0:
+                this->map_.reserve(this->map_.size() + this->rng_() % this->keys_);
+                break;
+            case 1:
+                this->map_.rehash(0);
+                break;
+            case 2:
+                this->map_.shrink_to_fit();
+                break;
+            case 3: {
+                // Move an element out through a node and back through merge()
+                uint64_t key = this->randomKey();
+                auto node = this->map_.extract(key);
+                this->expect(node.empty() == (this->ref_.count(key) == 0), "extract result");
+                Map other;
+                other.insert(std::move(node));
+                this->map_.merge(other);
+                this->expect(other.empty(), "merge leaves no absent key behind");
+                break;
+            }
+            default: {
+                // Erase a range from the front of the iteration order
+                auto last = this->map_.cbegin();
+                size_t n = std::min<size_t>(this->rng_() % 64, this->map_.size());
+                std::advance(last, n);
+                for (auto it = this->map_.cbegin(); it != last; ++it) {
+                    this->ref_.erase(it->first);
+                }
+                this->expect(this->map_.erase(this->map_.cbegin(), last) == n, "range erase");
+                break;
+            }
+            }
+        }
+        this->expect(this->map_.size() == this->ref_.size(), "size after table op");
+    }
+
+    void checkAll() {
+        this->expect(this->map_.size() == this->ref_.size(), "size at end of phase");
+        size_t visited = 0;
+        for (const auto &[key, value] : this->map_) {
+            auto expected = this->ref_.find(key);
+            this->expect(expected != this->ref_.end() && expected->second == value,
+                         "iterated element");
+            ++visited;
+        }
+        this->expect(visited == this->ref_.size(), "iteration visits every element once");
+        for (const auto &[key, value] : this->ref_) {
+            auto it = this->map_.find(key);
+            this->expect(it != this->map_.end() && it->second == value, "lookup of every key");
+        }
+    }
+
+    void expect(bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "%s: %s mismatch at op %zu (seed %llu)\n", this->name_, what,
+                         this->op_, static_cast<unsigned long long>(this->options_.seed));
+            std::exit(1);
+        }
+    }
+
+    const char* name_;
+    const Options &options_;
+    size_t keys_;
+    std::mt19937_64 rng_;
+    size_t op_ = 0;
+    Map map_;
+    Reference ref_;
+};
+
+template <typename Map>
+void differential(const char* name, const Options &options, size_t keys) {
+    DifferentialRun<Map>(name, options, keys).run();
+}
+
+/**
+ * @brief Every thread mutates the keys it owns in a shared ConcurrentHashMap
+ * and checks them against its own std::unordered_map, while the other threads
+ * mutate the rest of each shard.
+ */
+void concurrentDifferential(const Options &options) {
+    using Map = ConcurrentHashMap<uint64_t, uint64_t, MixHasher>;
+    Map map(16);
+    std::vector<Reference> refs(options.threads);
+    std::atomic<bool> failed = false;
+    std::vector<std::thread> threads;
+    size_t opsPerThread = options.ops / options.threads;
+    for (size_t t = 0; t < options.threads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937_64 rng(options.seed + t);
+            Reference &ref = refs[t];
+            for (size_t i = 0; i < opsPerThread && !failed; ++i) {
+                // Thread t owns the keys equal to t modulo the thread count
+                uint64_t key = rng() % options.keys * options.threads + t;
+                uint64_t value = rng();
+                bool ok = true;
+                switch (rng() % 4) {
+                case 0:
+                    ok = map.insert({key, value}) == ref.insert({key, value}).second;
+                    break;
+                case 1:
+                    ok = map.insert_or_assign(key, value) == ref.insert_or_assign(key, value).second;
+                    break;
+                case 2:
+                    ok = map.erase(key) == (ref.erase(key) == 1);
+                    break;
+                default: {
+                    auto found = map.get(key);
+                    auto expected = ref.find(key);
+                    ok = expected == ref.end() ? !found.has_value()
+                                               : found.has_value() && *found == expected->second;
+                    break;
+                }
+                }
+                if (!ok) {
+                    std::fprintf(stderr, "ConcurrentHashMap: mismatch in thread %zu at op %zu\n",
+                                 t, i);
+                    failed = true;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (failed) {
+        std::exit(1);
+    }
+    size_t expectedSize = 0;
+    for (const auto &ref : refs) {
+        expectedSize += ref.size();
+    }
+    size_t visited = 0;
+    bool ok = map.size() == expectedSize;
+    map.for_each([&](const auto &slot) {
+        const Reference &ref = refs[slot.first % options.threads];
+        auto expected = ref.find(slot.first);
+        ok = ok && expected != ref.end() && expected->second == slot.second;
+        ++visited;
+    });
+    if (!ok || visited != expectedSize) {
+        std::fprintf(stderr, "ConcurrentHashMap: final contents mismatch\n");
+        std::exit(1);
+    }
+    std::printf("%-28s ok  %zu ops on %zu threads, final size %zu\n", "ConcurrentHashMap",
+                opsPerThread * options.threads, options.threads, expectedSize);
+}
+
+/**
+ * @brief Log-linear latency histogram in the style of HdrHistogram. Values are
+ * bucketed by their power of two and then linearly into SubBuckets, which keeps
+ * every recorded value within 1 / SubBuckets of its bucket's lower bound.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SubBucketBits = 6;
+    static constexpr size_t SubBuckets = size_t(1) << SubBucketBits;
+
+    void record(uint64_t value) {
+        ++this->counts_[bucketOf(value)];
+        ++this->count_;
+        this->max_ = std::max(this->max_, value);
+    }
+
+    uint64_t count() const {
+        return this->count_;
+    }
+
+    uint64_t max() const {
+        return this->max_;
+    }
+
+    /**
+     * @brief Lower bound of the bucket holding the value at a percentile.
+     */
+    uint64_t percentile(double p) const {
+        if (this->count_ == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(std::ceil(p / 100 * static_cast<double>(this->count_)));
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < this->counts_.size(); ++i) {
+            seen += this->counts_[i];
+            if (seen >= rank) {
+                return std::min(lowerBound(i), this->max_);
+            }
+        }
+        return this->max_;
+    }
+
+private:
+    static constexpr size_t Magnitudes = 64 - SubBucketBits + 1;
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < SubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        size_t magnitude = 63 - static_cast<size_t>(__builtin_clzll(value)) - SubBucketBits + 1;
+        size_t sub = static_cast<size_t>(value >> magnitude) - SubBuckets / 2;
+        return SubBuckets + (magnitude - 1) * (SubBuckets / 2) + sub;
+    }
+
+    static uint64_t lowerBound(size_t bucket) {
+        if (bucket < SubBuckets) {
+            return bucket;
+        }
+        size_t magnitude = (bucket - SubBuckets) / (SubBuckets / 2) + 1;
+        uint64_t sub = (bucket - SubBuckets) % (SubBuckets / 2) + SubBuckets / 2;
+        return sub << magnitude;
+    }
+
+    std::array<uint64_t, SubBuckets + Magnitudes * (SubBuckets / 2)> counts_{};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+void printHistogram(const char* op, const LatencyHistogram &histogram) {
+    if (histogram.count() == 0) {
+        return;
+    }
+    std::printf("  %-16s %10llu %8llu %8llu %8llu %8llu %8llu %10llu\n", op,
+                static_cast<unsigned long long>(histogram.count()),
+                static_cast<unsigned long long>(histogram.percentile(50)),
+                static_cast<unsigned long long>(histogram.percentile(90)),
+                static_cast<unsigned long long>(histogram.percentile(99)),
+                static_cast<unsigned long long>(histogram.percentile(99.9)),
+                static_cast<unsigned long long>(histogram.percentile(99.99)),
+                static_cast<unsigned long long>(histogram.max()));
+}
+
+/**
+ * @brief Time every operation of a workload that grows a map through many
+ * resizes, churns it at its final size, and drains it. Operations during which
+ * the capacity changed are recorded separately, so that resize spikes show up
+ * next to the steady state instead of hiding in its tail.
+ */
+template <typename Map>
+void latency(const char* name, const Options &options) {
+    using Clock = std::chrono::steady_clock;
+    enum Op { Insert, InsertResize, FindHit, FindMiss, Erase, EraseResize, OpCount };
+    static constexpr std::array<const char*, OpCount> OpNames = {
+        "insert", "insert (resize)", "find hit", "find miss", "erase", "erase (resize)"};
+    std::array<LatencyHistogram, OpCount> histograms;
+
+    std::mt19937_64 rng(options.seed);
+    size_t n = options.ops / 4;
+    std::vector<uint64_t> keys(n);
+    for (auto &key : keys) {
+        // Even keys are present and odd keys miss
+        key = rng() & ~uint64_t(1);
+    }
+
+    Map map;
+    auto timed = [&](Op op, Op resizeOp, auto &&f) {
+        size_t capacity = capacityOf(map);
+        auto start = Clock::now();
+        f();
+        auto elapsed = Clock::now() - start;
+        Op recorded = capacityOf(map) == capacity ? op : resizeOp;
+        histograms[recorded].record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    };
+    uint64_t sink = 0;
+    for (size_t i = 0; i < n; ++i) {
+        timed(Insert, InsertResize, [&]() { map.insert({keys[i], i}); });
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = keys[rng() % n];
+        timed(FindHit, FindHit, [&]() { sink += map.find(key) != map.end(); });
+        timed(FindMiss, FindMiss, [&]() { sink += map.find(key | 1) != map.end(); });
+        // Churn at a steady size, leaving deleted slots for insertions to reclaim
+        timed(Erase, EraseResize, [&]() { map.erase(key); });
+        timed(Insert, InsertResize, [&]() { map.insert({key, i}); });
+    }
+    for (size_t i = 0; i < n; ++i) {
+        timed(Erase, EraseResize, [&]() { map.erase(keys[i]); });
+    }
+
+    std::printf("%s (ns, %zu keys, checksum %llu)\n", name, n,
+                static_cast<unsigned long long>(sink));
+    std::printf("  %-16s %10s %8s %8s %8s %8s %8s %10s\n", "op", "count", "p50", "p90", "p99",
+                "p99.9", "p99.99", "max");
+    for (size_t op = 0; op < OpCount; ++op) {
+        printHistogram(OpNames[op], histograms[op]);
+    }
+}
+
+template <typename Policy, typename Hash = MixHasher>
+using StressMap = HashMap<uint64_t, uint64_t, Hash, std::equal_to<uint64_t>, Policy>;
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+
+    if (options.latency) {
+        latency<StressMap<DefaultHashMapPolicy>>("HashMap", options);
+        latency<StressMap<PowerOfTwoHashMapPolicy>>("HashMap<PowerOfTwo>", options);
+        latency<StressMap<IncrementalHashMapPolicy>>("HashMap<Incremental>", options);
+        latency<StressMap<ShrinkingHashMapPolicy<>>>("HashMap<Shrinking>", options);
+        latency<StressMap<NodeHashMapPolicy<>>>("NodeHashMap", options);
+        latency<std::unordered_map<uint64_t, uint64_t, MixHasher>>("std::unordered_map", options);
+        return 0;
+    }
+
+    std::printf("seed %llu\n", static_cast<unsigned long long>(options.seed));
+    differential<StressMap<DefaultHashMapPolicy>>("HashMap", options, options.keys);
+    differential<StressMap<PowerOfTwoHashMapPolicy>>("HashMap<PowerOfTwo>", options, options.keys);
+    differential<StressMap<IncrementalHashMapPolicy>>("HashMap<Incremental>", options,
+                                                      options.keys);
+    differential<StressMap<ShrinkingHashMapPolicy<>>>("HashMap<Shrinking>", options, options.keys);
+    differential<StressMap<ShrinkingHashMapPolicy<IncrementalHashMapPolicy>>>(
+        "HashMap<ShrinkingIncremental>", options, options.keys);
+    differential<StressMap<NodeHashMapPolicy<>>>("NodeHashMap", options, options.keys);
+    differential<StressMap<StoreHashPolicy>>("HashMap<StoreHash>", options, options.keys);
+    differential<StressMap<StoreHashIncrementalPolicy>>("HashMap<StoreHashIncremental>", options,
+                                                        options.keys);
+    differential<StressMap<ParallelRehashPolicy>>("HashMap<ParallelRehash>", options,
+                                                  options.keys);
+    // Clustered keys probe linearly through their cluster, so fewer of them
+    differential<StressMap<DefaultHashMapPolicy, ClusterHasher>>(
+        "HashMap<ClusterHasher>", options, std::min<size_t>(options.keys, 2000));
+    differential<StressMap<PowerOfTwoHashMapPolicy, ClusterHasher>>(
+        "HashMap<PowerOfTwo,Cluster>", options, std::min<size_t>(options.keys, 2000));
+    differential<SmallHashMap<uint64_t, uint64_t, 8, MixHasher>>("SmallHashMap", options, 12);
+    concurrentDifferential(options);
+    return 0;
+}